@@ -11,14 +11,103 @@
 
 static_assert(sizeof(float) == 4);
 
+#if defined(__unix__) || defined(__APPLE__)
+    #define KAC10_EXPORTER_HAS_POSIX_IO
+#endif
+
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <cstdio>
+#include <atomic>
+#include <thread>
 #include <cmath>
 #include "export_kac_1_0.hpp"
 
+#ifdef KAC10_EXPORTER_HAS_POSIX_IO
+    #include <sys/uio.h>
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <cerrno>
+#endif
+
+// These are written into the file as they are in memory.
+static_assert(sizeof(kac_1_0_normal_s) == 12);
+static_assert(sizeof(kac_1_0_triangle_s) == 20);
+static_assert(sizeof(kac_1_0_uv_coordinates_s) == 8);
+static_assert(sizeof(kac_1_0_vertex_coordinates_s) == 12);
+
+// The sizes in the file of the items that are encoded on export.
+static const size_t MATERIAL_BYTE_SIZE = 6;
+static const size_t TEXTURE_METADATA_BYTE_SIZE = 20;
+
+static void encode_material(const kac_1_0_material_s &material, uint8_t *const dst)
+{
+    const uint16_t packedColor = (material.color.r << 0) |
+                                 (material.color.g << 4) |
+                                 (material.color.b << 8) |
+                                 (material.color.a << 12);
+
+    const uint32_t packedMetadata = ((material.metadata.textureIdx          & 0xffff) <<  0) |
+                                    ((material.metadata.hasTexture          & 0x1   ) << 16) |
+                                    ((material.metadata.hasSmoothShading    & 0x1   ) << 17);
+
+    std::memcpy((dst + 0), &packedColor, sizeof(packedColor));
+    std::memcpy((dst + 2), &packedMetadata, sizeof(packedMetadata));
+
+    return;
+}
+
+static void encode_texture_metadata(const kac_1_0_texture_metadata_s &metadata, uint8_t *const dst)
+{
+    assert((metadata.sideLength >= KAC_1_0_MIN_TEXTURE_SIDE_LENGTH) &&
+           (metadata.sideLength <= KAC_1_0_MAX_TEXTURE_SIDE_LENGTH) &&
+           ((metadata.sideLength & (metadata.sideLength - 1)) == 0) && // Power of two.
+           "Invalid texture dimensions.");
+
+    const uint32_t packedParams = ((metadata.sideLength     & 0xffff) <<  0) |
+                                  ((metadata.sampleLinearly & 0x1)    << 16) |
+                                  ((metadata.clampUV        & 0x1)    << 17);
+
+    std::memcpy((dst + 0), &packedParams, sizeof(packedParams));
+    std::memcpy((dst + 4), metadata.pixelHash, sizeof(metadata.pixelHash));
+
+    return;
+}
+
+// Packs the given mip level's pixels into the 16-bit format they're stored in.
+static void encode_texture_mip_level(const kac_1_0_texture_s &texture,
+                                     const unsigned mipLevel,
+                                     const uint32_t numPixels,
+                                     uint8_t *const dst)
+{
+    for (unsigned p = 0; p < numPixels; p++)
+    {
+        const kac_1_0_packed_texture_pixel_t packedColor = KAC_1_0_PACK_PIXEL(texture.mipLevel[mipLevel][p].r,
+                                                                              texture.mipLevel[mipLevel][p].g,
+                                                                              texture.mipLevel[mipLevel][p].b,
+                                                                              texture.mipLevel[mipLevel][p].a);
+
+        std::memcpy((dst + (p * sizeof(packedColor))), &packedColor, sizeof(packedColor));
+    }
+
+    return;
+}
+
+static void encode_texture_mip_level(const kac_1_0_packed_texture_s &texture,
+                                     const unsigned mipLevel,
+                                     const uint32_t numPixels,
+                                     uint8_t *const dst)
+{
+    std::memcpy(dst, texture.mipLevel[mipLevel], (numPixels * sizeof(kac_1_0_packed_texture_pixel_t)));
+
+    return;
+}
+
 export_kac_1_0_c::export_kac_1_0_c(const char *const outputFilename)
 {
     this->file = std::fopen(outputFilename, "wb");
+    this->stagingBuffer.reserve(STAGING_BUFFER_CAPACITY);
 
     return;
 }
@@ -26,6 +115,7 @@ export_kac_1_0_c::export_kac_1_0_c(const char *const outputFilename)
 bool export_kac_1_0_c::is_valid_output_stream(void) const
 {
     return bool(this->file &&
+                !this->writeFailed &&
                 !std::ferror(this->file));
 }
 
@@ -46,184 +136,955 @@ unsigned export_kac_1_0_c::reduce_8bit_color_value_to_5bit(const uint8_t val)
     return (unsigned(val / (255 / 31.0)) & 0b11111);
 }
 
-bool export_kac_1_0_c::write_header(void) const
+uint8_t* export_kac_1_0_c::reserve_staging_space(const size_t byteSize)
+{
+    if ((this->stagingBuffer.size() + byteSize) > STAGING_BUFFER_CAPACITY)
+    {
+        this->flush_pending_output();
+    }
+
+    const size_t byteOffset = this->stagingBuffer.size();
+
+    this->stagingBuffer.resize(byteOffset + byteSize);
+
+    // Consecutively staged bytes are gathered as a single entry.
+    if (!this->gatherList.empty() &&
+        !this->gatherList.back().data)
+    {
+        this->gatherList.back().byteSize += byteSize;
+    }
+    else
+    {
+        this->gatherList.push_back({nullptr, byteOffset, byteSize});
+    }
+
+    this->numPendingBytes += byteSize;
+
+    return (this->stagingBuffer.data() + byteOffset);
+}
+
+void export_kac_1_0_c::stage_bytes(const void *const data, const size_t byteSize)
+{
+    const uint8_t *src = (const uint8_t*)data;
+    size_t numBytesLeft = byteSize;
+
+    while (numBytesLeft)
+    {
+        const size_t chunkSize = std::min(numBytesLeft, STAGING_BUFFER_CAPACITY);
+
+        std::memcpy(this->reserve_staging_space(chunkSize), src, chunkSize);
+
+        src += chunkSize;
+        numBytesLeft -= chunkSize;
+    }
+
+    return;
+}
+
+template <typename T>
+void export_kac_1_0_c::stage_value(const T &value)
+{
+    this->stage_bytes(&value, sizeof(value));
+
+    return;
+}
+
+void export_kac_1_0_c::stage_reference(const void *const data, const size_t byteSize)
+{
+    if (byteSize)
+    {
+        this->gatherList.push_back({data, 0, byteSize});
+        this->numPendingBytes += byteSize;
+    }
+
+    return;
+}
+
+void export_kac_1_0_c::flush_pending_output(void)
+{
+    if (this->gatherList.empty())
+    {
+        return;
+    }
+
+    #ifdef KAC10_EXPORTER_HAS_POSIX_IO
+        // Anything in the stream's own buffer must be written out first, so that
+        // the writes to the file descriptor land after it.
+        std::fflush(this->file);
+
+        std::vector<iovec> iov;
+        iov.reserve(this->gatherList.size());
+
+        for (const auto &entry: this->gatherList)
+        {
+            iov.push_back({(entry.data? (void*)entry.data : (void*)(this->stagingBuffer.data() + entry.stagingByteOffset)),
+                           entry.byteSize});
+        }
+
+        const int fd = fileno(this->file);
+        const size_t maxIovCount = size_t(std::max(16L, sysconf(_SC_IOV_MAX)));
+        size_t iovIdx = 0;
+
+        // writev() may write fewer bytes than asked (or fewer entries than there
+        // are, if there are more than the system allows at once), in which case
+        // the rest are written with further calls.
+        while ((iovIdx < iov.size()) && !this->writeFailed)
+        {
+            const ssize_t numBytesWritten = writev(fd, &iov[iovIdx], int(std::min((iov.size() - iovIdx), maxIovCount)));
+
+            if (numBytesWritten < 0)
+            {
+                this->writeFailed = (errno != EINTR);
+                continue;
+            }
+
+            size_t numBytesLeft = size_t(numBytesWritten);
+
+            while ((iovIdx < iov.size()) && (numBytesLeft >= iov[iovIdx].iov_len))
+            {
+                numBytesLeft -= iov[iovIdx].iov_len;
+                iovIdx++;
+            }
+
+            if (numBytesLeft)
+            {
+                iov[iovIdx].iov_base = ((uint8_t*)iov[iovIdx].iov_base + numBytesLeft);
+                iov[iovIdx].iov_len -= numBytesLeft;
+            }
+        }
+    #else
+        for (const auto &entry: this->gatherList)
+        {
+            const void *const data = (entry.data? entry.data : (this->stagingBuffer.data() + entry.stagingByteOffset));
+
+            if (std::fwrite(data, 1, entry.byteSize, this->file) != entry.byteSize)
+            {
+                this->writeFailed = true;
+                break;
+            }
+        }
+    #endif
+
+    this->fileByteOffset += this->numPendingBytes;
+
+    this->gatherList.clear();
+    this->stagingBuffer.clear();
+    this->numPendingBytes = 0;
+
+    return;
+}
+
+uint32_t export_kac_1_0_c::output_byte_offset(void) const
+{
+    return uint32_t(this->fileByteOffset + this->numPendingBytes);
+}
+
+void export_kac_1_0_c::write_segment_identifier(const char *const identifier)
+{
+    segment_index_entry_s entry;
+
+    std::memcpy(entry.identifier, identifier, sizeof(entry.identifier));
+    entry.byteOffset = this->output_byte_offset();
+    entry.byteSize = 0;
+
+    this->segmentIndex.push_back(entry);
+
+    this->stage_bytes(identifier, 4);
+
+    return;
+}
+
+void export_kac_1_0_c::finish_segment_index_entry(void)
+{
+    assert(!this->segmentIndex.empty() && "No segment has been begun.");
+
+    this->segmentIndex.back().byteSize = (this->output_byte_offset() - this->segmentIndex.back().byteOffset);
+
+    // The segment has now been encoded in full.
+    this->flush_pending_output();
+
+    return;
+}
+
+bool export_kac_1_0_c::write_header(void)
+{
+    if (this->is_valid_output_stream())
+    {
+        this->write_segment_identifier("KAC ");
+        this->stage_value(this->formatVersion);
+        this->finish_segment_index_entry();
+    }
+
+    return this->is_valid_output_stream();
+}
+
+bool export_kac_1_0_c::write_uv_coordinates(const std::vector<kac_1_0_uv_coordinates_s> &uvCoordinates)
+{
+    return this->write_uv_coordinates(uvCoordinates.data(), uvCoordinates.size());
+}
+
+bool export_kac_1_0_c::write_uv_coordinates(const kac_1_0_uv_coordinates_s *const uvCoordinates, const size_t count)
 {
     if (this->is_valid_output_stream())
     {
-        std::fputs("KAC ", this->file);
-        std::fwrite((char*)&this->formatVersion, sizeof(this->formatVersion), 1, this->file);
+        this->write_segment_header("UV  ", count);
+        this->stage_reference(uvCoordinates, (count * sizeof(kac_1_0_uv_coordinates_s)));
+
+        this->finish_segment_index_entry();
     }
 
     return this->is_valid_output_stream();
 }
 
-bool export_kac_1_0_c::write_uv_coordinates(const std::vector<kac_1_0_uv_coordinates_s> &uvCoordinates) const
+bool export_kac_1_0_c::write_vertex_coordinates(const std::vector<kac_1_0_vertex_coordinates_s> &vertexCoordinates)
+{
+    return this->write_vertex_coordinates(vertexCoordinates.data(), vertexCoordinates.size());
+}
+
+bool export_kac_1_0_c::write_vertex_coordinates(const kac_1_0_vertex_coordinates_s *const vertexCoordinates, const size_t count)
 {
     if (this->is_valid_output_stream())
     {
-        const uint32_t numUVs = uvCoordinates.size();
+        this->write_segment_header("VERT", count);
+        this->stage_reference(vertexCoordinates, (count * sizeof(kac_1_0_vertex_coordinates_s)));
+
+        this->finish_segment_index_entry();
+    }
+
+    return this->is_valid_output_stream();
+}
+
+bool export_kac_1_0_c::write_materials(const std::vector<kac_1_0_material_s> &materials)
+{
+    return this->write_materials(materials.data(), materials.size());
+}
+
+bool export_kac_1_0_c::write_materials(const kac_1_0_material_s *const materials, const size_t count)
+{
+    return this->write_segment("MATE", materials, (materials + count));
+}
+
+bool export_kac_1_0_c::write_normals(const std::vector<kac_1_0_normal_s> &normals)
+{
+    return this->write_normals(normals.data(), normals.size());
+}
+
+bool export_kac_1_0_c::write_normals(const kac_1_0_normal_s *const normals, const size_t count)
+{
+    if (this->is_valid_output_stream())
+    {
+        this->write_segment_header("NORM", count);
+        this->stage_reference(normals, (count * sizeof(kac_1_0_normal_s)));
+
+        this->finish_segment_index_entry();
+    }
+
+    return this->is_valid_output_stream();
+}
+
+bool export_kac_1_0_c::write_triangles(const std::vector<kac_1_0_triangle_s> &triangles)
+{
+    return this->write_triangles(triangles.data(), triangles.size());
+}
+
+bool export_kac_1_0_c::write_triangles(const kac_1_0_triangle_s *const triangles, const size_t count)
+{
+    if (this->is_valid_output_stream())
+    {
+        this->write_segment_header("3MSH", count);
+        this->stage_reference(triangles, (count * sizeof(kac_1_0_triangle_s)));
+
+        this->finish_segment_index_entry();
+    }
+
+    return this->is_valid_output_stream();
+}
+
+void export_kac_1_0_c::write_segment_header(const char *const identifier, const uint32_t numElements)
+{
+    this->write_segment_identifier(identifier);
+    this->stage_value(numElements);
+
+    if (std::strncmp(identifier, "TXTR", 4) == 0)
+    {
+        this->textureIndex.clear();
+    }
+
+    return;
+}
+
+void export_kac_1_0_c::stage_element(const kac_1_0_normal_s &normal)
+{
+    this->stage_value(normal);
+
+    return;
+}
+
+void export_kac_1_0_c::stage_element(const kac_1_0_material_s &material)
+{
+    encode_material(material, this->reserve_staging_space(MATERIAL_BYTE_SIZE));
+
+    return;
+}
 
-        std::fputs("UV  ", this->file);
-        std::fwrite((char*)&numUVs, sizeof(numUVs), 1, this->file);
+void export_kac_1_0_c::stage_element(const kac_1_0_triangle_s &triangle)
+{
+    this->stage_value(triangle);
+
+    return;
+}
 
-        for (const auto &uv: uvCoordinates)
+void export_kac_1_0_c::stage_element(const kac_1_0_uv_coordinates_s &uvCoordinates)
+{
+    this->stage_value(uvCoordinates);
+
+    return;
+}
+
+void export_kac_1_0_c::stage_element(const kac_1_0_vertex_coordinates_s &vertex)
+{
+    this->stage_value(vertex);
+
+    return;
+}
+
+void export_kac_1_0_c::write_texture_metadata(const kac_1_0_texture_metadata_s &metadata)
+{
+    this->textureIndex.push_back({this->output_byte_offset(), {}});
+
+    encode_texture_metadata(metadata, this->reserve_staging_space(TEXTURE_METADATA_BYTE_SIZE));
+
+    return;
+}
+
+bool export_kac_1_0_c::write_textures(const std::map<std::string, kac_1_0_texture_s> &textures)
+{
+    if (this->is_valid_output_stream())
+    {
+        this->write_segment_header("TXTR", textures.size());
+        
+        for (const auto &[textureFilename, texture]: textures)
         {
-            std::fwrite((char*)&uv.u, sizeof(uv.u), 1, this->file);
-            std::fwrite((char*)&uv.v, sizeof(uv.v), 1, this->file);
+            this->stage_element(texture);
         }
+
+        this->finish_segment_index_entry();
     }
 
     return this->is_valid_output_stream();
 }
 
-bool export_kac_1_0_c::write_vertex_coordinates(const std::vector<kac_1_0_vertex_coordinates_s> &vertexCoordinates) const
+bool export_kac_1_0_c::write_textures(const kac_1_0_texture_s *const textures, const size_t count)
 {
-    if (this->is_valid_output_stream())
+    return this->write_segment("TXTR", textures, (textures + count));
+}
+
+void export_kac_1_0_c::stage_element(const kac_1_0_texture_s &texture)
+{
+    this->write_texture_metadata(texture.metadata);
+
+    // Write the texture's pixel data in progressively shrinking levels of mipmapping
+    // until we reach the smallest level.
+    for (unsigned m = 0; ; m++)
     {
-        const uint32_t numVertices = vertexCoordinates.size();
+        const uint32_t textureSideLen = (texture.metadata.sideLength / pow(2, m));
+        const uint32_t texturePixelCount = (textureSideLen * textureSideLen);
+
+        if (textureSideLen < KAC_1_0_MIN_TEXTURE_SIDE_LENGTH)
+        {
+            assert((m > 0) && "At least one level of mipmapping is required.");
+            break;
+        }
 
-        std::fputs("VERT", this->file);
-        std::fwrite((char*)&numVertices, sizeof(numVertices), 1, this->file);
+        assert((m < KAC_1_0_MAX_NUM_MIP_LEVELS) &&
+               "A texture is overflowing the maximum mip level count.");
 
-        for (const auto &vertex: vertexCoordinates)
+        this->textureIndex.back().mipLevels.push_back({{}, this->output_byte_offset(),
+                                                       uint32_t(texturePixelCount * sizeof(kac_1_0_packed_texture_pixel_t))});
+
+        // The mip level is packed straight into the staging buffer.
+        encode_texture_mip_level(texture, m, texturePixelCount,
+                                 this->reserve_staging_space(texturePixelCount * sizeof(kac_1_0_packed_texture_pixel_t)));
+    }
+
+    return;
+}
+
+bool export_kac_1_0_c::write_textures(const std::map<std::string, kac_1_0_packed_texture_s> &textures)
+{
+    if (this->is_valid_output_stream())
+    {
+        this->write_segment_header("TXTR", textures.size());
+        
+        for (const auto &[textureFilename, texture]: textures)
         {
-            std::fwrite((char*)&vertex.x, sizeof(vertex.x), 1, this->file);
-            std::fwrite((char*)&vertex.y, sizeof(vertex.y), 1, this->file);
-            std::fwrite((char*)&vertex.z, sizeof(vertex.z), 1, this->file);
+            this->stage_element(texture);
         }
+
+        this->finish_segment_index_entry();
     }
 
     return this->is_valid_output_stream();
 }
 
-bool export_kac_1_0_c::write_materials(const std::vector<kac_1_0_material_s> &materials) const
+bool export_kac_1_0_c::write_textures(const kac_1_0_packed_texture_s *const textures, const size_t count)
+{
+    return this->write_segment("TXTR", textures, (textures + count));
+}
+
+void export_kac_1_0_c::stage_element(const kac_1_0_packed_texture_s &texture)
+{
+    this->write_texture_metadata(texture.metadata);
+
+    // The pixels are already in the format in which they're stored in
+    // the file, so each mip level can be written out as is.
+    for (unsigned m = 0; ; m++)
+    {
+        const uint32_t textureSideLen = (texture.metadata.sideLength / pow(2, m));
+        const uint32_t texturePixelCount = (textureSideLen * textureSideLen);
+
+        if (textureSideLen < KAC_1_0_MIN_TEXTURE_SIDE_LENGTH)
+        {
+            assert((m > 0) && "At least one level of mipmapping is required.");
+            break;
+        }
+
+        assert((m < KAC_1_0_MAX_NUM_MIP_LEVELS) &&
+               "A texture is overflowing the maximum mip level count.");
+
+        this->textureIndex.back().mipLevels.push_back({{}, this->output_byte_offset(),
+                                                       uint32_t(texturePixelCount * sizeof(kac_1_0_packed_texture_pixel_t))});
+
+        this->stage_reference(texture.mipLevel[m], (texturePixelCount * sizeof(kac_1_0_packed_texture_pixel_t)));
+    }
+
+    return;
+}
+
+bool export_kac_1_0_c::write_index(void)
 {
     if (this->is_valid_output_stream())
     {
-        const uint32_t numMaterials = materials.size();
+        assert(!this->segmentIndex.empty() &&
+               (std::strncmp(this->segmentIndex.back().identifier, "TXTR", 4) == 0) &&
+               "The INDX segment must follow the TXTR segment.");
+
+        const uint32_t indexByteOffset = this->output_byte_offset();
+        const uint32_t numSegments = this->segmentIndex.size();
+        const uint32_t numTextures = this->textureIndex.size();
 
-        std::fputs("MATE", this->file);
-        std::fwrite((char*)&numMaterials, sizeof(numMaterials), 1, this->file);
+        this->stage_bytes("INDX", 4);
 
-        for (const auto &material: materials)
+        this->stage_value(numSegments);
+        for (const auto &segment: this->segmentIndex)
         {
-            const uint16_t packedColor = (material.color.r << 0) |
-                                         (material.color.g << 4) |
-                                         (material.color.b << 8) |
-                                         (material.color.a << 12);
+            this->stage_value(segment.identifier);
+            this->stage_value(segment.byteOffset);
+            this->stage_value(segment.byteSize);
+        }
 
-            std::fwrite((char*)&packedColor, sizeof(packedColor), 1, this->file);
+        this->stage_value(numTextures);
+        for (const auto &texture: this->textureIndex)
+        {
+            const uint32_t numMipLevels = texture.mipLevels.size();
 
-            const uint32_t packedMetadata = ((material.metadata.textureIdx          & 0xffff) <<  0) |
-                                            ((material.metadata.hasTexture          & 0x1   ) << 16) |
-                                            ((material.metadata.hasSmoothShading    & 0x1   ) << 17);
-                                            
-            std::fwrite((char*)&packedMetadata, sizeof(packedMetadata), 1, this->file);
+            this->stage_value(texture.byteOffset);
+            this->stage_value(numMipLevels);
+
+            for (const auto &mipLevel: texture.mipLevels)
+            {
+                this->stage_value(mipLevel.byteOffset);
+                this->stage_value(mipLevel.byteSize);
+            }
         }
+
+        // The trailer by which readers can find this segment from the end of the file.
+        this->stage_value(indexByteOffset);
+        this->stage_bytes("INDX", 4);
+
+        this->flush_pending_output();
     }
 
     return this->is_valid_output_stream();
 }
 
-bool export_kac_1_0_c::write_normals(const std::vector<kac_1_0_normal_s> &normals) const
+bool export_kac_1_0_c::begin_segment(const char *const identifier)
 {
+    assert(!this->streamedSegment.isOpen && "The previous segment hasn't been ended.");
+
+    assert(((std::strncmp(identifier, "NORM", 4) == 0) ||
+            (std::strncmp(identifier, "MATE", 4) == 0) ||
+            (std::strncmp(identifier, "3MSH", 4) == 0) ||
+            (std::strncmp(identifier, "UV  ", 4) == 0) ||
+            (std::strncmp(identifier, "VERT", 4) == 0) ||
+            (std::strncmp(identifier, "TXTR", 4) == 0)) &&
+           "Only segments of elements can be written in batches.");
+
+    this->streamedSegment.isOpen = true;
+    this->streamedSegment.numElements = 0;
+
     if (this->is_valid_output_stream())
     {
-        const uint32_t numNormals = normals.size();
+        this->write_segment_identifier(identifier);
 
-        std::fputs("NORM", this->file);
-        std::fwrite((char*)&numNormals, sizeof(numNormals), 1, this->file);
+        // The element count isn't known until the segment ends, so a placeholder
+        // goes in its place for now.
+        this->streamedSegment.countByteOffset = this->output_byte_offset();
+        this->stage_value(uint32_t(0));
 
-        for (const auto &normal: normals)
+        if (std::strncmp(identifier, "TXTR", 4) == 0)
         {
-            std::fwrite((char*)&normal.x, sizeof(normal.x), 1, this->file);
-            std::fwrite((char*)&normal.y, sizeof(normal.y), 1, this->file);
-            std::fwrite((char*)&normal.z, sizeof(normal.z), 1, this->file);
+            this->textureIndex.clear();
         }
     }
 
     return this->is_valid_output_stream();
 }
 
-bool export_kac_1_0_c::write_triangles(const std::vector<kac_1_0_triangle_s> &triangles) const
+bool export_kac_1_0_c::begin_append(const char *const identifier, const size_t count)
 {
-    if (this->is_valid_output_stream())
+    if (!this->is_valid_output_stream())
     {
-        const uint32_t numTriangles = triangles.size();
+        return false;
+    }
 
-        std::fputs("3MSH", this->file);
-        std::fwrite((char*)&numTriangles, sizeof(numTriangles), 1, this->file);
+    assert(this->streamedSegment.isOpen &&
+           (std::strncmp(this->segmentIndex.back().identifier, identifier, 4) == 0) &&
+           "The elements don't belong in the segment being written.");
 
-        for (const auto &triangle: triangles)
-        {
-            std::fwrite((char*)&triangle.materialIdx, sizeof(triangle.materialIdx), 1, this->file);
+    this->streamedSegment.numElements += count;
 
-            for (const auto &vertex: triangle.vertices)
-            {
-                std::fwrite((char*)&vertex.vertexCoordinatesIdx, sizeof(vertex.vertexCoordinatesIdx), 1, this->file);
-                std::fwrite((char*)&vertex.normalIdx, sizeof(vertex.normalIdx), 1, this->file);
-                std::fwrite((char*)&vertex.uvIdx, sizeof(vertex.uvIdx), 1, this->file);
-            }
+    return true;
+}
+
+bool export_kac_1_0_c::append_normals(const kac_1_0_normal_s *const normals, const size_t count)
+{
+    if (this->begin_append("NORM", count))
+    {
+        this->stage_bytes(normals, (count * sizeof(kac_1_0_normal_s)));
+    }
+
+    return this->is_valid_output_stream();
+}
+
+bool export_kac_1_0_c::append_materials(const kac_1_0_material_s *const materials, const size_t count)
+{
+    if (this->begin_append("MATE", count))
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            this->stage_element(materials[i]);
         }
     }
 
     return this->is_valid_output_stream();
 }
 
-bool export_kac_1_0_c::write_textures(const std::map<std::string, kac_1_0_texture_s> &textures) const
+bool export_kac_1_0_c::append_triangles(const kac_1_0_triangle_s *const triangles, const size_t count)
+{
+    if (this->begin_append("3MSH", count))
+    {
+        this->stage_bytes(triangles, (count * sizeof(kac_1_0_triangle_s)));
+    }
+
+    return this->is_valid_output_stream();
+}
+
+bool export_kac_1_0_c::append_uv_coordinates(const kac_1_0_uv_coordinates_s *const uvCoordinates, const size_t count)
+{
+    if (this->begin_append("UV  ", count))
+    {
+        this->stage_bytes(uvCoordinates, (count * sizeof(kac_1_0_uv_coordinates_s)));
+    }
+
+    return this->is_valid_output_stream();
+}
+
+bool export_kac_1_0_c::append_vertex_coordinates(const kac_1_0_vertex_coordinates_s *const vertexCoordinates, const size_t count)
+{
+    if (this->begin_append("VERT", count))
+    {
+        this->stage_bytes(vertexCoordinates, (count * sizeof(kac_1_0_vertex_coordinates_s)));
+    }
+
+    return this->is_valid_output_stream();
+}
+
+bool export_kac_1_0_c::append_texture(const kac_1_0_texture_s &texture)
 {
+    if (this->begin_append("TXTR", 1))
+    {
+        this->stage_element(texture);
+    }
+
+    return this->is_valid_output_stream();
+}
+
+bool export_kac_1_0_c::append_texture(const kac_1_0_packed_texture_s &texture)
+{
+    if (this->begin_append("TXTR", 1))
+    {
+        this->stage_element(texture);
+
+        // The pixels were referenced in place, and needn't stay valid after
+        // this call.
+        this->flush_pending_output();
+    }
+
+    return this->is_valid_output_stream();
+}
+
+bool export_kac_1_0_c::end_segment(void)
+{
+    assert(this->streamedSegment.isOpen && "No segment has been begun.");
+
+    this->streamedSegment.isOpen = false;
+
     if (this->is_valid_output_stream())
     {
-        const uint32_t numTextures = textures.size();
+        this->finish_segment_index_entry();
+
+        // Fill in the element count, then return to the end of the file.
+        if ((std::fseek(this->file, long(this->streamedSegment.countByteOffset), SEEK_SET) != 0) ||
+            (std::fwrite(&this->streamedSegment.numElements, sizeof(this->streamedSegment.numElements), 1, this->file) != 1) ||
+            (std::fseek(this->file, long(this->fileByteOffset), SEEK_SET) != 0))
+        {
+            this->writeFailed = true;
+        }
+    }
+
+    return this->is_valid_output_stream();
+}
+
+bool export_kac_1_0_c::write_file_parallel(const std::vector<kac_1_0_normal_s> &normals,
+                                           const std::vector<kac_1_0_uv_coordinates_s> &uvCoordinates,
+                                           const std::vector<kac_1_0_vertex_coordinates_s> &vertexCoordinates,
+                                           const std::vector<kac_1_0_triangle_s> &triangles,
+                                           const std::vector<kac_1_0_material_s> &materials,
+                                           const std::map<std::string, kac_1_0_texture_s> &textures,
+                                           const bool writeIndex,
+                                           const unsigned numThreads)
+{
+    return this->write_file_parallel<kac_1_0_texture_s>(normals, uvCoordinates, vertexCoordinates, triangles,
+                                                        materials, textures, writeIndex, numThreads);
+}
+
+bool export_kac_1_0_c::write_file_parallel(const std::vector<kac_1_0_normal_s> &normals,
+                                           const std::vector<kac_1_0_uv_coordinates_s> &uvCoordinates,
+                                           const std::vector<kac_1_0_vertex_coordinates_s> &vertexCoordinates,
+                                           const std::vector<kac_1_0_triangle_s> &triangles,
+                                           const std::vector<kac_1_0_material_s> &materials,
+                                           const std::map<std::string, kac_1_0_packed_texture_s> &textures,
+                                           const bool writeIndex,
+                                           const unsigned numThreads)
+{
+    return this->write_file_parallel<kac_1_0_packed_texture_s>(normals, uvCoordinates, vertexCoordinates, triangles,
+                                                               materials, textures, writeIndex, numThreads);
+}
+
+template <typename TextureType>
+bool export_kac_1_0_c::write_file_parallel(const std::vector<kac_1_0_normal_s> &normals,
+                                           const std::vector<kac_1_0_uv_coordinates_s> &uvCoordinates,
+                                           const std::vector<kac_1_0_vertex_coordinates_s> &vertexCoordinates,
+                                           const std::vector<kac_1_0_triangle_s> &triangles,
+                                           const std::vector<kac_1_0_material_s> &materials,
+                                           const std::map<std::string, TextureType> &textures,
+                                           const bool writeIndex,
+                                           const unsigned numThreads)
+{
+    const auto write_sequentially = [&]
+    {
+        return (this->write_header() &&
+                this->write_normals(normals) &&
+                this->write_uv_coordinates(uvCoordinates) &&
+                this->write_vertex_coordinates(vertexCoordinates) &&
+                this->write_triangles(triangles) &&
+                this->write_materials(materials) &&
+                this->write_textures(textures) &&
+                (!writeIndex || this->write_index()));
+    };
+
+    if (!this->is_valid_output_stream())
+    {
+        return false;
+    }
+
+    assert(this->segmentIndex.empty() &&
+           "Nothing may have been written into the file before write_file_parallel().");
+
+    // The data can only be written out of order into a seekable file.
+    std::fflush(this->file);
+    if (std::ftell(this->file) < 0)
+    {
+        return write_sequentially();
+    }
+
+    std::vector<parallel_write_task_s> tasks;
+    const size_t baseByteOffset = this->output_byte_offset();
+    size_t byteOffset = baseByteOffset;
+
+    // Notes the given segment in the index, and adds a task to write its
+    // identifier and the 4-byte value that follows it (the number of elements
+    // in the segment, or the format version).
+    const auto add_segment = [&](const char *const identifier, const uint32_t value, const size_t dataByteSize)
+    {
+        segment_index_entry_s entry;
+
+        std::memcpy(entry.identifier, identifier, sizeof(entry.identifier));
+        entry.byteOffset = uint32_t(byteOffset);
+        entry.byteSize = uint32_t(8 + dataByteSize);
+
+        this->segmentIndex.push_back(entry);
+
+        tasks.push_back({byteOffset, 8, nullptr, [identifier, value](uint8_t *const dst)
+        {
+            std::memcpy((dst + 0), identifier, 4);
+            std::memcpy((dst + 4), &value, sizeof(value));
+        }});
+
+        byteOffset += 8;
+    };
+
+    const auto add_in_place_data = [&](const void *const data, const size_t byteSize)
+    {
+        for (size_t chunkOffset = 0; chunkOffset < byteSize; chunkOffset += PARALLEL_WRITE_CHUNK_SIZE)
+        {
+            tasks.push_back({(byteOffset + chunkOffset),
+                             std::min(PARALLEL_WRITE_CHUNK_SIZE, (byteSize - chunkOffset)),
+                             ((const uint8_t*)data + chunkOffset),
+                             {}});
+        }
+
+        byteOffset += byteSize;
+    };
+
+    uint32_t versionValue;
+    std::memcpy(&versionValue, &this->formatVersion, sizeof(versionValue));
+    add_segment("KAC ", versionValue, 0);
+
+    add_segment("NORM", normals.size(), (normals.size() * sizeof(kac_1_0_normal_s)));
+    add_in_place_data(normals.data(), (normals.size() * sizeof(kac_1_0_normal_s)));
+
+    add_segment("UV  ", uvCoordinates.size(), (uvCoordinates.size() * sizeof(kac_1_0_uv_coordinates_s)));
+    add_in_place_data(uvCoordinates.data(), (uvCoordinates.size() * sizeof(kac_1_0_uv_coordinates_s)));
+
+    add_segment("VERT", vertexCoordinates.size(), (vertexCoordinates.size() * sizeof(kac_1_0_vertex_coordinates_s)));
+    add_in_place_data(vertexCoordinates.data(), (vertexCoordinates.size() * sizeof(kac_1_0_vertex_coordinates_s)));
+
+    add_segment("3MSH", triangles.size(), (triangles.size() * sizeof(kac_1_0_triangle_s)));
+    add_in_place_data(triangles.data(), (triangles.size() * sizeof(kac_1_0_triangle_s)));
+
+    add_segment("MATE", materials.size(), (materials.size() * MATERIAL_BYTE_SIZE));
+    {
+        const size_t numMaterialsPerTask = (PARALLEL_WRITE_CHUNK_SIZE / MATERIAL_BYTE_SIZE);
+
+        for (size_t first = 0; first < materials.size(); first += numMaterialsPerTask)
+        {
+            const size_t numMaterials = std::min(numMaterialsPerTask, (materials.size() - first));
+
+            tasks.push_back({byteOffset, (numMaterials * MATERIAL_BYTE_SIZE), nullptr, [&materials, first, numMaterials](uint8_t *const dst)
+            {
+                for (size_t i = 0; i < numMaterials; i++)
+                {
+                    encode_material(materials[first + i], (dst + (i * MATERIAL_BYTE_SIZE)));
+                }
+            }});
+
+            byteOffset += (numMaterials * MATERIAL_BYTE_SIZE);
+        }
+    }
+
+    // Each texture, with its metadata and all of its mip levels, is written
+    // by a task of its own.
+    {
+        std::vector<size_t> textureByteSizes;
 
-        std::fputs("TXTR", this->file);
-        std::fwrite((char*)&numTextures, sizeof(numTextures), 1, this->file);
-        
         for (const auto &[textureFilename, texture]: textures)
         {
-            assert((texture.metadata.sideLength >= KAC_1_0_MIN_TEXTURE_SIDE_LENGTH) &&
-                   (texture.metadata.sideLength <= KAC_1_0_MAX_TEXTURE_SIDE_LENGTH) &&
-                   ((texture.metadata.sideLength & (texture.metadata.sideLength - 1)) == 0) && // Power of two.
-                   "Invalid texture dimensions.");
+            size_t textureByteSize = TEXTURE_METADATA_BYTE_SIZE;
 
-            // Write the texture's metadata.
+            for (unsigned m = 0; (uint32_t(texture.metadata.sideLength) >> m) >= KAC_1_0_MIN_TEXTURE_SIDE_LENGTH; m++)
             {
-                const uint32_t packedParams = ((texture.metadata.sideLength     & 0xffff) <<  0) |
-                                              ((texture.metadata.sampleLinearly & 0x1)    << 16) |
-                                              ((texture.metadata.clampUV        & 0x1)    << 17);
+                const uint32_t textureSideLen = (uint32_t(texture.metadata.sideLength) >> m);
+
+                textureByteSize += (textureSideLen * textureSideLen * sizeof(kac_1_0_packed_texture_pixel_t));
+            }
+
+            textureByteSizes.push_back(textureByteSize);
+        }
+
+        size_t texturesByteSize = 0;
+        for (const size_t textureByteSize: textureByteSizes)
+        {
+            texturesByteSize += textureByteSize;
+        }
+
+        add_segment("TXTR", textures.size(), texturesByteSize);
+
+        this->textureIndex.clear();
+
+        unsigned textureIdx = 0;
+        for (const auto &[textureFilename, texture]: textures)
+        {
+            texture_index_entry_s indexEntry = {uint32_t(byteOffset), {}};
+            size_t mipLevelByteOffset = (byteOffset + TEXTURE_METADATA_BYTE_SIZE);
+
+            for (unsigned m = 0; (uint32_t(texture.metadata.sideLength) >> m) >= KAC_1_0_MIN_TEXTURE_SIDE_LENGTH; m++)
+            {
+                assert((m < KAC_1_0_MAX_NUM_MIP_LEVELS) &&
+                       "A texture is overflowing the maximum mip level count.");
+
+                const uint32_t textureSideLen = (uint32_t(texture.metadata.sideLength) >> m);
+                const uint32_t mipLevelByteSize = (textureSideLen * textureSideLen * sizeof(kac_1_0_packed_texture_pixel_t));
 
-                std::fwrite((char*)&packedParams, sizeof(packedParams), 1, this->file);
-                std::fwrite((char*)&texture.metadata.pixelHash, sizeof(texture.metadata.pixelHash), 1, this->file);
+                indexEntry.mipLevels.push_back({{}, uint32_t(mipLevelByteOffset), mipLevelByteSize});
+                mipLevelByteOffset += mipLevelByteSize;
             }
 
-            // Write the texture's pixel data in progressively shrinking levels of mipmapping
-            // until we reach the smallest level.
-            for (unsigned m = 0; ; m++)
+            this->textureIndex.push_back(indexEntry);
+
+            tasks.push_back({byteOffset, textureByteSizes[textureIdx], nullptr, [&texture = texture](uint8_t *const dst)
+            {
+                encode_texture_metadata(texture.metadata, dst);
+
+                uint8_t *mipLevelDst = (dst + TEXTURE_METADATA_BYTE_SIZE);
+
+                for (unsigned m = 0; (uint32_t(texture.metadata.sideLength) >> m) >= KAC_1_0_MIN_TEXTURE_SIDE_LENGTH; m++)
+                {
+                    const uint32_t textureSideLen = (uint32_t(texture.metadata.sideLength) >> m);
+                    const uint32_t texturePixelCount = (textureSideLen * textureSideLen);
+
+                    encode_texture_mip_level(texture, m, texturePixelCount, mipLevelDst);
+                    mipLevelDst += (texturePixelCount * sizeof(kac_1_0_packed_texture_pixel_t));
+                }
+            }});
+
+            byteOffset += textureByteSizes[textureIdx++];
+        }
+    }
+
+    // Reserve the file's full size up front, so that the file system can
+    // allocate it in one go rather than as the writes arrive out of order. This
+    // is only an optimization; if it fails, the writes extend the file.
+    #if defined(KAC10_EXPORTER_HAS_POSIX_IO) && !defined(__APPLE__)
+    posix_fallocate(fileno(this->file), off_t(baseByteOffset), off_t(byteOffset - baseByteOffset));
+    #endif
+
+    this->run_parallel_write_tasks(tasks, numThreads);
+
+    // Continue any further writing after the data.
+    if (!this->writeFailed &&
+        (std::fseek(this->file, long(byteOffset), SEEK_SET) != 0))
+    {
+        this->writeFailed = true;
+    }
+
+    this->fileByteOffset = byteOffset;
+
+    return (this->is_valid_output_stream() &&
+            (!writeIndex || this->write_index()));
+}
+
+void export_kac_1_0_c::run_parallel_write_tasks(const std::vector<parallel_write_task_s> &tasks, const unsigned numThreads)
+{
+    #ifdef KAC10_EXPORTER_HAS_POSIX_IO
+        const int fd = fileno(this->file);
+        std::atomic<size_t> nextTaskIdx{0};
+        std::atomic<bool> failed{false};
+
+        const auto worker = [&]
+        {
+            std::vector<uint8_t> encodeBuffer;
+
+            while (!failed)
             {
-                const uint32_t textureSideLen = (texture.metadata.sideLength / pow(2, m));
-                const uint32_t texturePixelCount = (textureSideLen * textureSideLen);
+                const size_t taskIdx = nextTaskIdx++;
 
-                if (textureSideLen < KAC_1_0_MIN_TEXTURE_SIDE_LENGTH)
+                if (taskIdx >= tasks.size())
                 {
-                    assert((m > 0) && "At least one level of mipmapping is required.");
                     break;
                 }
 
-                assert((m < KAC_1_0_MAX_NUM_MIP_LEVELS) &&
-                       "A texture is overflowing the maximum mip level count.");
+                const parallel_write_task_s &task = tasks[taskIdx];
+                const uint8_t *src = (const uint8_t*)task.data;
 
-                for (unsigned p = 0; p < texturePixelCount; p++)
+                if (!src)
                 {
-                    const uint16_t packedColor = (texture.mipLevel[m][p].r << 0)  |
-                                                 (texture.mipLevel[m][p].g << 5)  |
-                                                 (texture.mipLevel[m][p].b << 10) |
-                                                 (texture.mipLevel[m][p].a << 15);
+                    encodeBuffer.resize(task.byteSize);
+                    task.encode(encodeBuffer.data());
+                    src = encodeBuffer.data();
+                }
 
-                    std::fwrite((char*)&packedColor, sizeof(packedColor), 1, this->file);
+                // pwrite() may write fewer bytes than asked, in which case the
+                // rest are written with further calls.
+                for (size_t numBytesWritten = 0; numBytesWritten < task.byteSize;)
+                {
+                    const ssize_t numBytes = pwrite(fd, (src + numBytesWritten),
+                                                    (task.byteSize - numBytesWritten),
+                                                    off_t(task.byteOffset + numBytesWritten));
+
+                    if (numBytes <= 0)
+                    {
+                        if ((numBytes < 0) && (errno == EINTR))
+                        {
+                            continue;
+                        }
+
+                        failed = true;
+                        break;
+                    }
+
+                    numBytesWritten += size_t(numBytes);
                 }
             }
+        };
+
+        const unsigned numWorkers = std::max(1u, unsigned(std::min(size_t(numThreads? numThreads : std::thread::hardware_concurrency()),
+                                                                   tasks.size())));
+
+        // The calling thread acts as one of the workers.
+        std::vector<std::thread> threads;
+        for (unsigned i = 1; i < numWorkers; i++)
+        {
+            threads.emplace_back(worker);
         }
-    }
 
-    return this->is_valid_output_stream();
+        worker();
+
+        for (auto &thread: threads)
+        {
+            thread.join();
+        }
+
+        if (failed)
+        {
+            this->writeFailed = true;
+        }
+    #else
+        // Without pwrite(), the tasks are run in order on the calling thread, the
+        // stream being positioned at the first of them.
+        (void)numThreads;
+
+        std::vector<uint8_t> encodeBuffer;
+
+        for (const auto &task: tasks)
+        {
+            const void *src = task.data;
+
+            if (!src)
+            {
+                encodeBuffer.resize(task.byteSize);
+                task.encode(encodeBuffer.data());
+                src = encodeBuffer.data();
+            }
+
+            if (std::fwrite(src, 1, task.byteSize, this->file) != task.byteSize)
+            {
+                this->writeFailed = true;
+                break;
+            }
+        }
+    #endif
+
+    return;
 }
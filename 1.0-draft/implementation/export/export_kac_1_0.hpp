@@ -10,7 +10,12 @@
 #ifndef EXPORT_KAC_1_0_H
 #define EXPORT_KAC_1_0_H
 
+#include <type_traits>
+#include <functional>
+#include <iterator>
 #include <vector>
+#include <string>
+#include <cstdio>
 #include <map>
 #include "../kac_1_0_types.h"
 
@@ -26,13 +31,156 @@ class export_kac_1_0_c
         // Functionality to write the various KAC 1.0 data segments into the file.
         // For details, refer to the KAC 1.0 specification. The functions return
         // true if the writing succeeded; false otherwise.
-        bool write_header(void) const;
-        bool write_normals(const std::vector<kac_1_0_normal_s> &normals) const;
-        bool write_materials(const std::vector<kac_1_0_material_s> &materials) const;
-        bool write_triangles(const std::vector<kac_1_0_triangle_s> &triangles) const;
-        bool write_uv_coordinates(const std::vector<kac_1_0_uv_coordinates_s> &uvCoordinates) const;
-        bool write_vertex_coordinates(const std::vector<kac_1_0_vertex_coordinates_s> &vertices) const;
-        bool write_textures(const std::map<std::string, kac_1_0_texture_s> &textures) const;
+        bool write_header(void);
+        bool write_normals(const std::vector<kac_1_0_normal_s> &normals);
+        bool write_materials(const std::vector<kac_1_0_material_s> &materials);
+        bool write_triangles(const std::vector<kac_1_0_triangle_s> &triangles);
+        bool write_uv_coordinates(const std::vector<kac_1_0_uv_coordinates_s> &uvCoordinates);
+        bool write_vertex_coordinates(const std::vector<kac_1_0_vertex_coordinates_s> &vertices);
+        bool write_textures(const std::map<std::string, kac_1_0_texture_s> &textures);
+        bool write_textures(const std::map<std::string, kac_1_0_packed_texture_s> &textures);
+
+        // The above, for elements held in other than a std::vector or std::map:
+        // given as a pointer and an element count; as any contiguous range that
+        // std::data() and std::size() accept, like a std::span, a std::array or a
+        // container with data() and size(); or as a pair of forward iterators, in
+        // which case the elements needn't be contiguous, and are copied one at a
+        // time. Single-pass iterators, like std::istream_iterator, aren't accepted,
+        // since the range is walked once to count the elements and again to write
+        // them.
+        // Textures are written in the order given, which is the order by which
+        // materials index them.
+        bool write_normals(const kac_1_0_normal_s *const normals, const size_t count);
+        bool write_materials(const kac_1_0_material_s *const materials, const size_t count);
+        bool write_triangles(const kac_1_0_triangle_s *const triangles, const size_t count);
+        bool write_uv_coordinates(const kac_1_0_uv_coordinates_s *const uvCoordinates, const size_t count);
+        bool write_vertex_coordinates(const kac_1_0_vertex_coordinates_s *const vertices, const size_t count);
+        bool write_textures(const kac_1_0_texture_s *const textures, const size_t count);
+        bool write_textures(const kac_1_0_packed_texture_s *const textures, const size_t count);
+
+        template <typename Range>
+        auto write_normals(const Range &normals) -> decltype(this->write_normals(std::data(normals), std::size(normals)))
+        {
+            return this->write_normals(std::data(normals), std::size(normals));
+        }
+
+        template <typename Range>
+        auto write_materials(const Range &materials) -> decltype(this->write_materials(std::data(materials), std::size(materials)))
+        {
+            return this->write_materials(std::data(materials), std::size(materials));
+        }
+
+        template <typename Range>
+        auto write_triangles(const Range &triangles) -> decltype(this->write_triangles(std::data(triangles), std::size(triangles)))
+        {
+            return this->write_triangles(std::data(triangles), std::size(triangles));
+        }
+
+        template <typename Range>
+        auto write_uv_coordinates(const Range &uvCoordinates) -> decltype(this->write_uv_coordinates(std::data(uvCoordinates), std::size(uvCoordinates)))
+        {
+            return this->write_uv_coordinates(std::data(uvCoordinates), std::size(uvCoordinates));
+        }
+
+        template <typename Range>
+        auto write_vertex_coordinates(const Range &vertices) -> decltype(this->write_vertex_coordinates(std::data(vertices), std::size(vertices)))
+        {
+            return this->write_vertex_coordinates(std::data(vertices), std::size(vertices));
+        }
+
+        template <typename Range>
+        auto write_textures(const Range &textures) -> decltype(this->write_textures(std::data(textures), std::size(textures)))
+        {
+            return this->write_textures(std::data(textures), std::size(textures));
+        }
+
+        template <typename Iterator>
+        bool write_normals(Iterator first, Iterator last)
+        {
+            return this->write_segment("NORM", first, last);
+        }
+
+        template <typename Iterator>
+        bool write_materials(Iterator first, Iterator last)
+        {
+            return this->write_segment("MATE", first, last);
+        }
+
+        template <typename Iterator>
+        bool write_triangles(Iterator first, Iterator last)
+        {
+            return this->write_segment("3MSH", first, last);
+        }
+
+        template <typename Iterator>
+        bool write_uv_coordinates(Iterator first, Iterator last)
+        {
+            return this->write_segment("UV  ", first, last);
+        }
+
+        template <typename Iterator>
+        bool write_vertex_coordinates(Iterator first, Iterator last)
+        {
+            return this->write_segment("VERT", first, last);
+        }
+
+        template <typename Iterator>
+        bool write_textures(Iterator first, Iterator last)
+        {
+            return this->write_segment("TXTR", first, last);
+        }
+
+        // Writes the optional INDX segment, which lists where in the file each of
+        // the segments, textures and mip levels written so far are, so that readers
+        // can locate them without walking through the file. If written, this must
+        // be the last segment in the file, following TXTR.
+        bool write_index(void);
+
+        // Functionality to write a segment in batches, for when its data aren't
+        // all in memory at once. begin_segment() starts the segment with the given
+        // identifier ("NORM", "MATE", "3MSH", "UV  ", "VERT" or "TXTR"), after which
+        // its elements are appended with any number of calls to the append_xxx()
+        // function that matches the segment, and end_segment() then finishes it,
+        // filling in the number of elements appended. The appended data are copied,
+        // so they needn't outlive the call. The result is the same as that of the
+        // corresponding write_xxx() function. Since the element count is written
+        // once the segment is done, this requires a seekable file.
+        bool begin_segment(const char *const identifier);
+        bool append_normals(const kac_1_0_normal_s *const normals, const size_t count);
+        bool append_materials(const kac_1_0_material_s *const materials, const size_t count);
+        bool append_triangles(const kac_1_0_triangle_s *const triangles, const size_t count);
+        bool append_uv_coordinates(const kac_1_0_uv_coordinates_s *const uvCoordinates, const size_t count);
+        bool append_vertex_coordinates(const kac_1_0_vertex_coordinates_s *const vertexCoordinates, const size_t count);
+        bool append_texture(const kac_1_0_texture_s &texture);
+        bool append_texture(const kac_1_0_packed_texture_s &texture);
+        bool end_segment(void);
+
+        // Writes a complete file: does the same as write_header(), write_normals(),
+        // write_uv_coordinates(), write_vertex_coordinates(), write_triangles(),
+        // write_materials(), write_textures() and (if 'writeIndex' is true)
+        // write_index(), in that order, and produces the same bytes. The sizes of
+        // the segments are known in advance, so the file's layout is worked out
+        // first, after which the segments and the textures are encoded and written
+        // into their places in the file concurrently, on 'numThreads' threads (or
+        // on one per hardware thread, if 0). Nothing may have been written into the
+        // file before. Where the file can't be written at arbitrary offsets (e.g.
+        // a pipe), this falls back to writing the segments one after another.
+        bool write_file_parallel(const std::vector<kac_1_0_normal_s> &normals,
+                                 const std::vector<kac_1_0_uv_coordinates_s> &uvCoordinates,
+                                 const std::vector<kac_1_0_vertex_coordinates_s> &vertexCoordinates,
+                                 const std::vector<kac_1_0_triangle_s> &triangles,
+                                 const std::vector<kac_1_0_material_s> &materials,
+                                 const std::map<std::string, kac_1_0_texture_s> &textures,
+                                 const bool writeIndex = true,
+                                 const unsigned numThreads = 0);
+        bool write_file_parallel(const std::vector<kac_1_0_normal_s> &normals,
+                                 const std::vector<kac_1_0_uv_coordinates_s> &uvCoordinates,
+                                 const std::vector<kac_1_0_vertex_coordinates_s> &vertexCoordinates,
+                                 const std::vector<kac_1_0_triangle_s> &triangles,
+                                 const std::vector<kac_1_0_material_s> &materials,
+                                 const std::map<std::string, kac_1_0_packed_texture_s> &textures,
+                                 const bool writeIndex = true,
+                                 const unsigned numThreads = 0);
 
         // Utility functions.
         static unsigned reduce_8bit_color_value_to_1bit(const uint8_t val);
@@ -40,7 +188,161 @@ class export_kac_1_0_c
         static unsigned reduce_8bit_color_value_to_5bit(const uint8_t val);
 
     private:
+        // An entry in the INDX segment for a segment, or for a texture and its
+        // mip levels.
+        struct segment_index_entry_s
+        {
+            char identifier[4];
+            uint32_t byteOffset;
+            uint32_t byteSize;
+        };
+
+        struct texture_index_entry_s
+        {
+            uint32_t byteOffset;
+            std::vector<segment_index_entry_s> mipLevels; // The identifiers are unused.
+        };
+
+        // Writes the identifier that starts the given segment, and notes where in
+        // the file the segment begins, for the INDX segment. Once the segment has
+        // been written, finish_segment_index_entry() should be called to note its
+        // size.
+        void write_segment_identifier(const char *const identifier);
+        void finish_segment_index_entry(void);
+
+        // Appends the given bytes to the staging buffer, flushing the pending
+        // output into the file whenever the buffer fills up.
+        void stage_bytes(const void *const data, const size_t byteSize);
+        template <typename T> void stage_value(const T &value);
+
+        // Returns a pointer to the given number of bytes at the end of the staging
+        // buffer, to be filled in by the caller; flushing the pending output first
+        // if there isn't room.
+        uint8_t* reserve_staging_space(const size_t byteSize);
+
+        // Queues the given bytes to be written into the file in place, without
+        // copying them into the staging buffer. They must remain valid until the
+        // next flush_pending_output(), i.e. until the current segment is done.
+        void stage_reference(const void *const data, const size_t byteSize);
+
+        // Writes the pending output (the staged and referenced bytes, in the order
+        // they were queued) into the file, with a single writev() where available.
+        void flush_pending_output(void);
+
+        // The byte offset in the file at which the next queued byte will be.
+        uint32_t output_byte_offset(void) const;
+
+        // Writes the identifier and element count that begin the given segment.
+        void write_segment_header(const char *const identifier, const uint32_t numElements);
+
+        // Writes the metadata of an individual texture.
+        void write_texture_metadata(const kac_1_0_texture_metadata_s &metadata);
+
+        // Queues the given element to be written into the current segment. The
+        // pixels of a packed texture are referenced in place.
+        void stage_element(const kac_1_0_normal_s &normal);
+        void stage_element(const kac_1_0_material_s &material);
+        void stage_element(const kac_1_0_triangle_s &triangle);
+        void stage_element(const kac_1_0_uv_coordinates_s &uvCoordinates);
+        void stage_element(const kac_1_0_vertex_coordinates_s &vertex);
+        void stage_element(const kac_1_0_texture_s &texture);
+        void stage_element(const kac_1_0_packed_texture_s &texture);
+
+        // Writes the given segment with the elements in the given iterator range.
+        template <typename Iterator>
+        bool write_segment(const char *const identifier, Iterator first, Iterator last)
+        {
+            static_assert(std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<Iterator>::iterator_category>::value,
+                          "The elements must be given as a range of forward iterators.");
+
+            if (this->is_valid_output_stream())
+            {
+                this->write_segment_header(identifier, uint32_t(std::distance(first, last)));
+
+                for (; first != last; ++first)
+                {
+                    this->stage_element(*first);
+                }
+
+                this->finish_segment_index_entry();
+            }
+
+            return this->is_valid_output_stream();
+        }
+
+        // Checks that elements of the given segment can be appended, and counts
+        // them as part of the segment being written in batches.
+        bool begin_append(const char *const identifier, const size_t count);
+
+        // A contiguous range of bytes to be written into the file by
+        // write_file_parallel(): either the bytes at 'data', in place, or (if
+        // 'data' is NULL) those produced by 'encode' into a buffer of 'byteSize'.
+        struct parallel_write_task_s
+        {
+            size_t byteOffset;
+            size_t byteSize;
+            const void *data;
+            std::function<void(uint8_t *const dst)> encode;
+        };
+
+        // In-place data are split into tasks of at most this many bytes, so that
+        // large segments are spread over the threads.
+        static constexpr size_t PARALLEL_WRITE_CHUNK_SIZE = (4 * 1024 * 1024);
+
+        template <typename TextureType>
+        bool write_file_parallel(const std::vector<kac_1_0_normal_s> &normals,
+                                 const std::vector<kac_1_0_uv_coordinates_s> &uvCoordinates,
+                                 const std::vector<kac_1_0_vertex_coordinates_s> &vertexCoordinates,
+                                 const std::vector<kac_1_0_triangle_s> &triangles,
+                                 const std::vector<kac_1_0_material_s> &materials,
+                                 const std::map<std::string, TextureType> &textures,
+                                 const bool writeIndex,
+                                 const unsigned numThreads);
+
+        // Runs the given tasks on the given number of threads, each writing its
+        // bytes into the file with pwrite().
+        void run_parallel_write_tasks(const std::vector<parallel_write_task_s> &tasks, const unsigned numThreads);
+
         std::FILE *file;
+
+        // The data are encoded into this buffer rather than written into the file
+        // piece by piece. Data that are already in their on-disk format, like
+        // vertex coordinates and packed texture pixels, are instead referenced in
+        // place. The resulting gather list is written into the file with a single
+        // call once a segment has been encoded, or when the buffer fills up.
+        std::vector<uint8_t> stagingBuffer;
+        static constexpr size_t STAGING_BUFFER_CAPACITY = (1024 * 1024);
+
+        // An entry in the gather list: either bytes of the staging buffer ('data'
+        // is NULL), or bytes referenced in place.
+        struct gather_entry_s
+        {
+            const void *data;
+            size_t stagingByteOffset;
+            size_t byteSize;
+        };
+
+        std::vector<gather_entry_s> gatherList;
+        size_t numPendingBytes = 0;
+
+        // The byte offset in the file at which the pending output will be written,
+        // i.e. the number of bytes written into the file so far. Tracked here so
+        // that finding the offset doesn't require querying the stream.
+        size_t fileByteOffset = 0;
+
+        // Set if writing the pending output failed.
+        bool writeFailed = false;
+
+        // The segment being written with begin_segment() and end_segment(), if any.
+        struct streamed_segment_s
+        {
+            bool isOpen = false;
+            uint32_t countByteOffset = 0;
+            uint32_t numElements = 0;
+        } streamedSegment;
+
+        std::vector<segment_index_entry_s> segmentIndex;
+        std::vector<texture_index_entry_s> textureIndex;
         const float formatVersion = KAC_1_0_VERSION_VALUE;
 };
 
@@ -6,4 +6,4 @@ SOURCE_FILES="
 ../export_kac_1_0.cpp
 "
 
-g++-9 -g -pipe -Wall -pedantic -O2 -std=c++17 -fPIC -isystem /usr/include/x86_64-linux-gnu/qt5/ $SOURCE_FILES -o ./bin/obj2kac -lQt5Core -lQt5Gui
+g++-9 -g -pipe -Wall -pedantic -O2 -std=c++17 -fPIC -isystem /usr/include/x86_64-linux-gnu/qt5/ $SOURCE_FILES -o ./bin/obj2kac -pthread -lQt5Core -lQt5Gui
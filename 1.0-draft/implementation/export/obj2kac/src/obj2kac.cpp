@@ -31,7 +31,11 @@ struct kac_1_0_data_s
     std::vector<kac_1_0_uv_coordinates_s> uvCoords;
     std::vector<kac_1_0_material_s> materials;
     std::vector<kac_1_0_triangle_s> triangles;
-    std::map<std::string, kac_1_0_texture_s> textures;
+    std::map<std::string, kac_1_0_packed_texture_s> textures;
+
+    // Owns the pixel data of the textures in 'textures'. All mip levels of a
+    // texture are held in one contiguous block.
+    std::vector<std::vector<kac_1_0_packed_texture_pixel_t>> texturePixels;
     std::vector<kac_1_0_normal_s> normals;
 };
 
@@ -213,7 +217,7 @@ static bool make_kac_data_from_obj(kac_1_0_data_s &kacData,
 
                 texture = texture.mirrored(false, true);
 
-                kac_1_0_texture_s kacTexture;
+                kac_1_0_packed_texture_s kacTexture;
 
                 // The base texture side length at mip level 0.
                 kacTexture.metadata.sideLength = texture.width();
@@ -223,9 +227,18 @@ static bool make_kac_data_from_obj(kac_1_0_data_s &kacData,
                 kacTexture.metadata.sampleLinearly = 1;
                 kacTexture.metadata.clampUV = 0;
 
+                // Allocate room for the pixels of all of the texture's mip levels at once.
+                std::vector<kac_1_0_packed_texture_pixel_t> mipChainPixels;
+                for (unsigned m = 0; (unsigned(kacTexture.metadata.sideLength) >> m) >= KAC_1_0_MIN_TEXTURE_SIDE_LENGTH; m++)
+                {
+                    const unsigned mipLevelSideLength = (unsigned(kacTexture.metadata.sideLength) >> m);
+
+                    mipChainPixels.resize(mipChainPixels.size() + (mipLevelSideLength * mipLevelSideLength));
+                }
+
                 // Save the texture's pixels. We'll generate and save successively smaller
                 // levels of mipmapping, from the texture's base size down to 1 x 1.
-                for (unsigned m = 0; ; m++)
+                for (unsigned m = 0, mipLevelOffset = 0; ; m++)
                 {
                     const bool textureHasAlpha = texture.hasAlphaChannel();
                     const uint32_t mipLevelSideLength = (kacTexture.metadata.sideLength / pow(2, m));
@@ -269,7 +282,9 @@ static bool make_kac_data_from_obj(kac_1_0_data_s &kacData,
                         return false;
                     }
 
-                    kacTexture.mipLevel[m] = new kac_1_0_texture_s::kac_1_0_texture_pixel_s[texture.width() * texture.height()];
+                    kacTexture.mipLevel[m] = (mipChainPixels.data() + mipLevelOffset);
+                    kacTexture.numMipLevels = (m + 1);
+                    mipLevelOffset += (texture.width() * texture.height());
 
                     for (int y = 0; y < texture.height(); y++)
                     {
@@ -278,17 +293,19 @@ static bool make_kac_data_from_obj(kac_1_0_data_s &kacData,
                             const QColor pixel(texture.pixelColor(x, y));
 
                             const unsigned texIdx = (x + y * texture.width());
-                            kacTexture.mipLevel[m][texIdx].r = export_kac_1_0_c::reduce_8bit_color_value_to_5bit(pixel.red());
-                            kacTexture.mipLevel[m][texIdx].g = export_kac_1_0_c::reduce_8bit_color_value_to_5bit(pixel.green());
-                            kacTexture.mipLevel[m][texIdx].b = export_kac_1_0_c::reduce_8bit_color_value_to_5bit(pixel.blue());
-                            kacTexture.mipLevel[m][texIdx].a = export_kac_1_0_c::reduce_8bit_color_value_to_1bit(textureHasAlpha? pixel.alpha() : 255);
+                            kacTexture.mipLevel[m][texIdx] = KAC_1_0_PACK_PIXEL(export_kac_1_0_c::reduce_8bit_color_value_to_5bit(pixel.red()),
+                                                                                export_kac_1_0_c::reduce_8bit_color_value_to_5bit(pixel.green()),
+                                                                                export_kac_1_0_c::reduce_8bit_color_value_to_5bit(pixel.blue()),
+                                                                                export_kac_1_0_c::reduce_8bit_color_value_to_1bit(textureHasAlpha? pixel.alpha() : 255));
                         }
                     }
                 }
 
                 // Create a hash of the texture's pixel data at mip level 0.
                 {
-                    const unsigned pixelDataByteSize = (texture.width() * texture.height() * 2);
+                    const unsigned pixelDataByteSize = (kacTexture.metadata.sideLength *
+                                                        kacTexture.metadata.sideLength *
+                                                        sizeof(kac_1_0_packed_texture_pixel_t));
 
                     const QByteArray pixelData((const char*)kacTexture.mipLevel[0], pixelDataByteSize);
                     QByteArray hash = QCryptographicHash::hash(pixelData, QCryptographicHash::Sha256);
@@ -298,6 +315,7 @@ static bool make_kac_data_from_obj(kac_1_0_data_s &kacData,
                 }
 
                 kacData.textures[tinyMaterial.diffuse_texname] = kacTexture;
+                kacData.texturePixels.push_back(std::move(mipChainPixels));
             }
         }
 
@@ -483,13 +501,13 @@ int main(int argc, char *argv[])
     }
 
     export_kac_1_0_c kacFile(outputFileName.c_str());
-    if (!kacFile.write_header() ||
-        !kacFile.write_normals(kacData.normals) ||
-        !kacFile.write_uv_coordinates(kacData.uvCoords) ||
-        !kacFile.write_vertex_coordinates(kacData.vertexCoords) ||
-        !kacFile.write_triangles(kacData.triangles) ||
-        !kacFile.write_materials(kacData.materials) ||
-        !kacFile.write_textures(kacData.textures))
+    if (!kacFile.write_file_parallel(kacData.normals,
+                                     kacData.uvCoords,
+                                     kacData.vertexCoords,
+                                     kacData.triangles,
+                                     kacData.materials,
+                                     kacData.textures,
+                                     true))
     {
         std::cerr << "Failed to write the output file\n";
         return 1;
@@ -0,0 +1,303 @@
+/*
+ * 2019 Tarpeeksi Hyvae Soft
+ * 
+ * Software: Batch file reader for the KAC 1.0 data format.
+ * 
+ */
+
+#include "batch_import_kac_1_0.hpp"
+
+batch_import_kac_1_0_c::batch_import_kac_1_0_c(const unsigned numThreads,
+                                               const io_backend_e ioBackend) :
+    threadPool(numThreads)
+{
+    if (ioBackend != io_backend_e::thread_pool)
+    {
+        this->ioUring = std::make_unique<io_uring_file_reader_c>();
+
+        if (!this->ioUring->is_available())
+        {
+            this->ioUring.reset();
+        }
+    }
+
+    return;
+}
+
+batch_import_kac_1_0_c::io_backend_e batch_import_kac_1_0_c::io_backend(void) const
+{
+    return (this->ioUring? io_backend_e::io_uring : io_backend_e::thread_pool);
+}
+
+bool batch_import_kac_1_0_c::read_file_data(kac10_reader_t *const reader, kac_1_0_file_data_s &data)
+{
+    kac10_segment_sizes_s sizes;
+
+    // The sizes are checked against the file's size, so a corrupted element
+    // count fails the file here rather than in the allocations below.
+    if (!kac10_reader__query_sizes_r(reader, &sizes))
+    {
+        return false;
+    }
+
+    // Each segment is read directly into its vector. A segment that doesn't
+    // exist in the file has a count of 0, and is left empty.
+    data.normals.resize(sizes.numNormals);
+    data.materials.resize(sizes.numMaterials);
+    data.triangles.resize(sizes.numTriangles);
+    data.uvCoordinates.resize(sizes.numUVCoordinates);
+    data.vertexCoordinates.resize(sizes.numVertexCoordinates);
+
+    if ((kac10_reader__read_normals_into_r(reader, data.normals.data(), sizes.normalsByteSize) != sizes.numNormals) ||
+        (kac10_reader__read_materials_into_r(reader, data.materials.data(), sizes.materialsByteSize) != sizes.numMaterials) ||
+        (kac10_reader__read_triangles_into_r(reader, data.triangles.data(), sizes.trianglesByteSize) != sizes.numTriangles) ||
+        (kac10_reader__read_uv_coordinates_into_r(reader, data.uvCoordinates.data(), sizes.uvCoordinatesByteSize) != sizes.numUVCoordinates) ||
+        (kac10_reader__read_vertex_coordinates_into_r(reader, data.vertexCoordinates.data(), sizes.vertexCoordinatesByteSize) != sizes.numVertexCoordinates))
+    {
+        return false;
+    }
+
+    if (sizes.numTextures)
+    {
+        data.textures = std::shared_ptr<kac10_texture_set_s>(new kac10_texture_set_s(),
+                                                             [](kac10_texture_set_s *const textureSet)
+                                                             {
+                                                                 kac10_reader__free_texture_set(textureSet);
+                                                                 delete textureSet;
+                                                             });
+
+        if (kac10_reader__read_texture_set_r(reader, data.textures.get()) != sizes.numTextures)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool batch_import_kac_1_0_c::read_file_data_parallel(kac10_reader_t *const reader, kac_1_0_file_data_s &data)
+{
+    kac10_segment_sizes_s sizes;
+    kac10_reader_t *const probe = kac10_reader__duplicate_r(reader);
+
+    // Readers that read from a file stream can't be duplicated.
+    if (!probe)
+    {
+        return read_file_data(reader, data);
+    }
+
+    kac10_reader__close_file_r(probe);
+
+    // Querying the sizes also gathers the texture layout, which the duplicate
+    // readers then share. As in read_file_data(), the sizes have been checked
+    // against the file's size.
+    if (!kac10_reader__query_sizes_r(reader, &sizes))
+    {
+        return false;
+    }
+
+    data.normals.resize(sizes.numNormals);
+    data.materials.resize(sizes.numMaterials);
+    data.triangles.resize(sizes.numTriangles);
+    data.uvCoordinates.resize(sizes.numUVCoordinates);
+    data.vertexCoordinates.resize(sizes.numVertexCoordinates);
+
+    if (sizes.numTextures)
+    {
+        data.textures = std::shared_ptr<kac10_texture_set_s>(new kac10_texture_set_s(),
+                                                             [](kac10_texture_set_s *const textureSet)
+                                                             {
+                                                                 kac10_reader__free_texture_set(textureSet);
+                                                                 delete textureSet;
+                                                             });
+
+        if (kac10_reader__prepare_texture_set_r(reader, data.textures.get()) != sizes.numTextures)
+        {
+            return false;
+        }
+    }
+
+    // Each segment, and each texture, is read on its own task with its own
+    // duplicate of the reader. The tasks write into disjoint memory.
+    std::vector<std::future<bool>> tasks;
+    bool success = true;
+
+    // Room for all of the tasks' futures is reserved up front, so that a future
+    // can't be lost to a failed allocation after its task has been submitted.
+    // If submitting a task fails, those already submitted are still waited for
+    // below.
+    tasks.reserve(5 + sizes.numTextures);
+
+    try
+    {
+        const auto spawn_task = [this, reader, &tasks](std::function<bool(kac10_reader_t *const)> readFn)
+        {
+            tasks.push_back(this->threadPool.async([reader, readFn]
+            {
+                kac10_reader_t *const duplicate = kac10_reader__duplicate_r(reader);
+                const bool success = (duplicate && readFn(duplicate));
+
+                return (kac10_reader__close_file_r(duplicate) && success);
+            }));
+        };
+
+        if (sizes.numNormals)
+        {
+            spawn_task([&](kac10_reader_t *const r){ return (kac10_reader__read_normals_into_r(r, data.normals.data(), sizes.normalsByteSize) == sizes.numNormals); });
+        }
+
+        if (sizes.numMaterials)
+        {
+            spawn_task([&](kac10_reader_t *const r){ return (kac10_reader__read_materials_into_r(r, data.materials.data(), sizes.materialsByteSize) == sizes.numMaterials); });
+        }
+
+        if (sizes.numTriangles)
+        {
+            spawn_task([&](kac10_reader_t *const r){ return (kac10_reader__read_triangles_into_r(r, data.triangles.data(), sizes.trianglesByteSize) == sizes.numTriangles); });
+        }
+
+        if (sizes.numUVCoordinates)
+        {
+            spawn_task([&](kac10_reader_t *const r){ return (kac10_reader__read_uv_coordinates_into_r(r, data.uvCoordinates.data(), sizes.uvCoordinatesByteSize) == sizes.numUVCoordinates); });
+        }
+
+        if (sizes.numVertexCoordinates)
+        {
+            spawn_task([&](kac10_reader_t *const r){ return (kac10_reader__read_vertex_coordinates_into_r(r, data.vertexCoordinates.data(), sizes.vertexCoordinatesByteSize) == sizes.numVertexCoordinates); });
+        }
+
+        for (uint32_t i = 0; i < sizes.numTextures; i++)
+        {
+            spawn_task([&data, i](kac10_reader_t *const r){ return (kac10_reader__fill_texture_set_r(r, data.textures.get(), i, 1) == 1); });
+        }
+    }
+    catch (...)
+    {
+        success = false;
+    }
+
+    // All of the tasks must finish before returning, since they reference
+    // 'data' and 'sizes'.
+    for (auto &task: tasks)
+    {
+        this->threadPool.wait(task);
+        success = (task.get() && success);
+    }
+
+    return success;
+}
+
+kac_1_0_batch_result_s batch_import_kac_1_0_c::read_opened_file(const std::string &filename, kac10_reader_t *const reader)
+{
+    kac_1_0_batch_result_s result;
+
+    result.filename = filename;
+
+    if (reader)
+    {
+        // An exception (e.g. a failed allocation) mustn't escape into the worker
+        // thread, where it would terminate the program, nor leave the caller
+        // without a result; the file is reported as failed instead.
+        try
+        {
+            result.success = this->read_file_data_parallel(reader, result.data);
+        }
+        catch (...)
+        {
+            result.success = false;
+        }
+
+        result.success = (kac10_reader__close_file_r(reader) && result.success);
+    }
+
+    return result;
+}
+
+kac_1_0_batch_result_s batch_import_kac_1_0_c::read_file_parallel(const std::string &filename)
+{
+    return this->read_opened_file(filename, kac10_reader__open_file_mapped_r(filename.c_str()));
+}
+
+void batch_import_kac_1_0_c::read_file(const std::string &filename, completion_callback_t onCompletion)
+{
+    if (!this->ioUring)
+    {
+        this->threadPool.submit([this, filename, onCompletion]
+        {
+            onCompletion(this->read_opened_file(filename, kac10_reader__open_file_mapped_r(filename.c_str())));
+        });
+
+        return;
+    }
+
+    // The file's contents arrive on the io_uring reader's I/O thread, from where
+    // they're handed over to the thread pool for decoding.
+    this->ioUring->read_file(filename, [this, filename, onCompletion](std::shared_ptr<std::vector<uint8_t>> fileData, const bool success)
+    {
+        this->threadPool.submit([this, filename, onCompletion, fileData, success]() mutable
+        {
+            kac_1_0_batch_result_s result = this->read_opened_file(filename, (success? kac10_reader__open_memory_r(fileData->data(), fileData->size()) : nullptr));
+
+            // The decoded data don't refer to the file's contents, so these can be
+            // let go already, freeing room in the reader's memory budget for more
+            // files.
+            fileData.reset();
+
+            onCompletion(std::move(result));
+        });
+    });
+
+    return;
+}
+
+std::vector<std::future<kac_1_0_batch_result_s>> batch_import_kac_1_0_c::read_files(const std::vector<std::string> &filenames)
+{
+    std::vector<std::future<kac_1_0_batch_result_s>> results;
+
+    results.reserve(filenames.size());
+
+    for (const auto &filename: filenames)
+    {
+        const auto promise = std::make_shared<std::promise<kac_1_0_batch_result_s>>();
+
+        results.push_back(promise->get_future());
+
+        this->read_file(filename, [promise](kac_1_0_batch_result_s &&result){ promise->set_value(std::move(result)); });
+    }
+
+    return results;
+}
+
+void batch_import_kac_1_0_c::read_files(const std::vector<std::string> &filenames, completion_callback_t onCompletion)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->pendingMutex);
+        this->numPending += filenames.size();
+    }
+
+    for (const auto &filename: filenames)
+    {
+        this->read_file(filename, [this, onCompletion](kac_1_0_batch_result_s &&result)
+        {
+            onCompletion(std::move(result));
+
+            std::lock_guard<std::mutex> lock(this->pendingMutex);
+
+            if (!--this->numPending)
+            {
+                this->pendingDone.notify_all();
+            }
+        });
+    }
+
+    return;
+}
+
+void batch_import_kac_1_0_c::wait(void)
+{
+    std::unique_lock<std::mutex> lock(this->pendingMutex);
+
+    this->pendingDone.wait(lock, [this]{ return !this->numPending; });
+
+    return;
+}
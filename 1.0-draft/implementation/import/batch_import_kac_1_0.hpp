@@ -0,0 +1,131 @@
+/*
+ * 2019 Tarpeeksi Hyvae Soft
+ * 
+ * Software: Batch file reader for the KAC 1.0 data format.
+ * 
+ * Provides functionality to read many KAC 1.0 files concurrently, on a pool of
+ * worker threads, using the reentrant functions of the KAC 1.0 file reader. On
+ * Linux, the files can be read in with io_uring.
+ * 
+ */
+
+#ifndef BATCH_IMPORT_KAC_1_0_H
+#define BATCH_IMPORT_KAC_1_0_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <mutex>
+#include <vector>
+#include "io_uring_file_reader.hpp"
+#include "work_stealing_pool.hpp"
+#include "import_kac_1_0.h"
+
+// The contents of a KAC 1.0 file, as decoded by the batch reader.
+struct kac_1_0_file_data_s
+{
+    std::vector<kac_1_0_normal_s> normals;
+    std::vector<kac_1_0_material_s> materials;
+    std::vector<kac_1_0_triangle_s> triangles;
+    std::vector<kac_1_0_uv_coordinates_s> uvCoordinates;
+    std::vector<kac_1_0_vertex_coordinates_s> vertexCoordinates;
+
+    // The textures with their packed pixels, in a single allocation. NULL if the
+    // file has no textures.
+    std::shared_ptr<kac10_texture_set_s> textures;
+};
+
+// The outcome of reading one file of a batch.
+struct kac_1_0_batch_result_s
+{
+    std::string filename;
+
+    // Whether the file was successfully opened and all of its data read. If
+    // false, 'data' may be incomplete.
+    bool success = false;
+
+    kac_1_0_file_data_s data;
+};
+
+class batch_import_kac_1_0_c
+{
+    public:
+        typedef std::function<void(kac_1_0_batch_result_s &&result)> completion_callback_t;
+
+        // How the files' data are brought into memory for decoding.
+        enum class io_backend_e
+        {
+            // io_uring if available, otherwise thread_pool.
+            automatic,
+
+            // Each worker thread maps its file into memory and reads it synchronously.
+            thread_pool,
+
+            // The files are read into memory asynchronously with io_uring, with
+            // many reads in flight at once, and each is decoded on a worker thread
+            // as soon as its read completes. Falls back to thread_pool if io_uring
+            // isn't available.
+            io_uring,
+        };
+
+        // If 'numThreads' is 0, one worker thread is created per hardware thread.
+        batch_import_kac_1_0_c(const unsigned numThreads = 0,
+                               const io_backend_e ioBackend = io_backend_e::automatic);
+
+        // Returns the I/O backend in use, i.e. never io_backend_e::automatic.
+        io_backend_e io_backend(void) const;
+
+        // Starts reading the given files concurrently. Returns one future per file,
+        // in the order of 'filenames'.
+        std::vector<std::future<kac_1_0_batch_result_s>> read_files(const std::vector<std::string> &filenames);
+
+        // Starts reading the given files concurrently, calling 'onCompletion' with
+        // each file's result as soon as the file has been read. The callback is
+        // called from the worker threads, possibly from several at once, and in no
+        // particular order. Use wait() to wait for all of the files to be read.
+        void read_files(const std::vector<std::string> &filenames, completion_callback_t onCompletion);
+
+        // Waits until all files passed to read_files() with a completion callback
+        // have been read and their callbacks have returned.
+        void wait(void);
+
+        // Reads the given file, decoding its segments and textures concurrently on
+        // the worker threads, and returns the result once done. This is for single
+        // large files, which would otherwise be decoded on one thread; the files
+        // of a batch passed to read_files() are decoded this way too.
+        kac_1_0_batch_result_s read_file_parallel(const std::string &filename);
+
+        // Reads all data from the given open reader. Returns true on success; false
+        // otherwise.
+        static bool read_file_data(kac10_reader_t *const reader, kac_1_0_file_data_s &data);
+
+        // Like read_file_data(), but reads each segment and each texture on its own
+        // task on the worker threads, with duplicates of the reader (see
+        // kac10_reader__duplicate_r()). Readers that can't be duplicated, i.e.
+        // that read from a file stream, are read with read_file_data() instead.
+        bool read_file_data_parallel(kac10_reader_t *const reader, kac_1_0_file_data_s &data);
+
+    private:
+        // Reads the given file on the I/O backend, and calls 'onCompletion' from a
+        // worker thread with the result.
+        void read_file(const std::string &filename, completion_callback_t onCompletion);
+
+        // Reads all data from the given reader, which has been opened on the given
+        // file (or is NULL if the file couldn't be opened), then closes the reader.
+        kac_1_0_batch_result_s read_opened_file(const std::string &filename, kac10_reader_t *const reader);
+
+        // The number of callback-based reads still in progress.
+        std::mutex pendingMutex;
+        std::condition_variable pendingDone;
+        unsigned numPending = 0;
+
+        // Declared last, so that they're destroyed (and their queued reads
+        // finished) before the members above, which the reads use. The io_uring
+        // reader hands its reads to the thread pool, so must go first.
+        work_stealing_pool_c threadPool;
+        std::unique_ptr<io_uring_file_reader_c> ioUring;
+};
+
+#endif
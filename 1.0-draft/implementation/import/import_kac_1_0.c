@@ -9,13 +9,31 @@
  * 
  */
 
+#if defined(__unix__) || defined(__APPLE__)
+    #define _POSIX_C_SOURCE 200809L
+    #define KAC10_READER_HAS_MMAP
+#endif
+
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <math.h>
 #include "import_kac_1_0.h"
 
+#ifdef KAC10_READER_HAS_MMAP
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+/* On x86 with GCC or Clang, texture pixels are unpacked with SSE2 or AVX2,
+ * selected at run-time based on what the CPU supports.*/
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define KAC10_READER_HAS_X86_SIMD
+    #include <immintrin.h>
+#endif
+
 /* An ID for each of the possible segments in a KAC 1.0 file.*/
 enum
 {
@@ -32,50 +50,289 @@ enum
     KAC_1_0_NUM_SEGMENTS
 };
 
-/* The KAC file we'll be reading from. This variable will be assigned at run-time
- * by a call to kac10_reader__open_file().*/
-static FILE *INPUT_FILE;
+struct kac10_reader_s
+{
+    /* The KAC file we'll be reading from, if it was opened with
+     * kac10_reader__open_file_r().*/
+    FILE *file;
+
+    /* If the file was opened with kac10_reader__open_file_mapped_r(), its
+     * contents in memory, in which case 'file' will be NULL. 'dataPos' is the
+     * current read position in the data, and 'dataError' is set if a read has
+     * gone past the end of the data.*/
+    const uint8_t *data;
+    size_t dataSize;
+    size_t dataPos;
+    int dataError;
+
+    /* Whether 'data' was mapped with mmap() (= 1) or malloc()'d and read in
+     * from the file (= 0), i.e. how it should be released.*/
+    int dataIsMmapped;
+
+    /* Whether 'data' is owned by the caller (given to kac10_reader__open_memory()),
+     * in which case the reader doesn't release it.*/
+    int dataIsExternal;
+
+    /* Bit flags (KAC_1_0_SEGMENT_ID_xxx) for whether a given segment exists in
+     * the file.*/
+    uint32_t segmentsInFile;
+
+    /* Byte offsets in the input file of the various data segments.*/
+    uint32_t segmentByteOffsets[KAC_1_0_NUM_SEGMENTS];
+
+    /* The number of elements in each of the data segments, except for TXTR,
+     * whose count is in 'numTextures'.*/
+    uint32_t segmentElementCounts[KAC_1_0_NUM_SEGMENTS];
+
+    /* The layout of the TXTR segment, one entry per texture. This will be
+     * initialized on demand by scan_texture_structure().*/
+    struct texture_info_s
+    {
+        uint32_t byteOffset; /* Of the texture's metadata in the file.*/
+        uint32_t sideLength;
+        uint32_t numMipLevels;
+        uint32_t numPixels; /* Across all mip levels.*/
+    } *textureInfo;
+    uint32_t numTextures;
+    int texturesScanned;
+
+    /* Whether 'textureInfo' belongs to the reader that this one is a duplicate
+     * of (see kac10_reader__duplicate_r()), in which case it isn't freed.*/
+    int textureInfoIsBorrowed;
+
+    /* The segments decoded on demand by the kac10_reader__get_xxx_r() functions,
+     * indexed by KAC_1_0_SEGMENT_ID_xxx. A segment whose data can be accessed in
+     * place in memory isn't copied, in which case the cache doesn't own 'data'.
+     * The textures are cached in 'textureCache'.*/
+    struct segment_cache_s
+    {
+        const void *data;
+        uint32_t numElements;
+        int isCached;
+        int isOwned;
+    } segmentCache[KAC_1_0_NUM_SEGMENTS];
+    struct kac10_texture_set_s textureCache;
+
+    /* The allocator used for the data returned to the caller and for scratch
+     * memory, which can be changed with kac10_reader__set_allocator_r(); and
+     * the allocator that was in effect when the reader was opened, which is
+     * used for the reader's own state.*/
+    struct kac10_allocator_s allocator;
+    struct kac10_allocator_s ownAllocator;
+    /* The order in which the texture read functions place the pixels of each
+     * mip level, as set with kac10_reader__set_texture_layout_r().*/
+    enum kac10_texture_layout_e textureLayout;
+};
+
+#define ALLOCATOR_MALLOC(allocator, size)        ((allocator).mallocFn((size), (allocator).userData))
+#define ALLOCATOR_CALLOC(allocator, count, size) ((allocator).callocFn((count), (size), (allocator).userData))
+#define ALLOCATOR_FREE(allocator, ptr)           ((allocator).freeFn((ptr), (allocator).userData))
 
-/* Bit flags (KAC_1_0_SEGMENT_ID_xxx) for whether a given segment exists in the
- * current KAC file. This will be initialized by kac10_reader__open_file().*/
-static uint32_t SEGMENTS_IN_FILE;
+static void* default_malloc(const size_t size, void *const userData)
+{
+    (void)userData;
 
-/* Byte offsets in the input file of the various data segments. This will be
- * initialized by kac10_reader__open_file().*/
-static uint32_t SEGMENT_BYTE_OFFSETS[KAC_1_0_NUM_SEGMENTS];
+    return malloc(size);
+}
 
-int kac10_reader__input_stream_is_valid(void)
+static void* default_calloc(const size_t count, const size_t size, void *const userData)
+{
+    (void)userData;
+
+    return calloc(count, size);
+}
+
+static void default_free(void *const ptr, void *const userData)
+{
+    (void)userData;
+
+    free(ptr);
+
+    return;
+}
+
+/* The allocator that new readers will use. Can be changed with
+ * kac10_reader__set_allocator().*/
+static struct kac10_allocator_s GLOBAL_ALLOCATOR = {default_malloc, default_calloc, default_free, NULL};
+
+/* Rounds the given byte size up to a multiple of KAC10_READER_ARENA_ALIGNMENT.*/
+#define ARENA_ALIGNED_SIZE(byteSize) (((byteSize) + (KAC10_READER_ARENA_ALIGNMENT - 1)) &\
+                                      ~(size_t)(KAC10_READER_ARENA_ALIGNMENT - 1))
+
+/* The reader used by the functions that don't take a reader as an argument.
+ * This will be assigned at run-time by a call to kac10_reader__open_file().*/
+static kac10_reader_t *GLOBAL_READER;
+
+int kac10_reader__input_stream_is_valid_r(const kac10_reader_t *const reader)
+{
+    if (reader->data)
+    {
+        return !reader->dataError;
+    }
+
+    return ((reader->file != NULL) &&
+            !ferror(reader->file) &&
+            !feof(reader->file));
+}
+
+/* Equivalents of fread(), fseek() and ftell() that operate on whichever input
+ * is open: the file stream or the file's contents in memory.*/
+static size_t input_read(kac10_reader_t *const reader,
+                         void *const dst, const size_t numBytes)
+{
+    if (reader->data)
+    {
+        if ((reader->dataPos > reader->dataSize) ||
+            (numBytes > (reader->dataSize - reader->dataPos)))
+        {
+            reader->dataError = 1;
+            return 0;
+        }
+
+        memcpy(dst, (reader->data + reader->dataPos), numBytes);
+        reader->dataPos += numBytes;
+
+        return numBytes;
+    }
+
+    return fread(dst, 1, numBytes, reader->file);
+}
+
+static int input_seek(kac10_reader_t *const reader, const long offset, const int origin)
+{
+    if (reader->data)
+    {
+        const long base = ((origin == SEEK_SET)? 0 :
+                           (origin == SEEK_CUR)? (long)reader->dataPos :
+                                                 (long)reader->dataSize);
+
+        if ((base + offset) < 0)
+        {
+            return -1;
+        }
+
+        reader->dataPos = (base + offset);
+
+        return 0;
+    }
+
+    return fseek(reader->file, offset, origin);
+}
+
+static long input_tell(const kac10_reader_t *const reader)
+{
+    return (reader->data? (long)reader->dataPos : ftell(reader->file));
+}
+
+/* Returns the size in bytes of the input; or 0 if it can't be determined. The
+ * current position in the input is left as it was.*/
+static size_t input_byte_size(kac10_reader_t *const reader)
+{
+    long startPos = 0, endPos = 0;
+
+    if (reader->data)
+    {
+        return reader->dataSize;
+    }
+
+    if (((startPos = ftell(reader->file)) < 0) ||
+        (fseek(reader->file, 0, SEEK_END) != 0))
+    {
+        return 0;
+    }
+
+    endPos = ftell(reader->file);
+    fseek(reader->file, startPos, SEEK_SET);
+
+    return ((endPos < 0)? 0 : (size_t)endPos);
+}
+
+/* Returns 1 if the element count of the given segment, as found when opening
+ * the file, fits in the bytes that follow the segment's count in an input of
+ * 'inputByteSize' bytes, or if the segment isn't in the file; 0 otherwise.*/
+static int segment_fits_input(const kac10_reader_t *const reader,
+                              const unsigned segmentId,
+                              const size_t elementByteSize,
+                              const size_t inputByteSize)
+{
+    const size_t dataOffset = (reader->segmentByteOffsets[segmentId] + sizeof(uint32_t));
+
+    if (!(reader->segmentsInFile & (1 << segmentId)))
+    {
+        return 1;
+    }
+
+    return ((dataOffset <= inputByteSize) &&
+            (reader->segmentElementCounts[segmentId] <= ((inputByteSize - dataOffset) / elementByteSize)));
+}
+
+/* Clears any read errors and returns to the start of the input.*/
+static void input_rewind(kac10_reader_t *const reader)
+{
+    if (reader->data)
+    {
+        reader->dataError = 0;
+        reader->dataPos = 0;
+    }
+    else
+    {
+        rewind(reader->file);
+    }
+
+    return;
+}
+
+/* Returns the number of mip levels (down to 1 x 1) of a texture whose base mip
+ * level has the given side length, and sets 'numPixels' to the total number of
+ * pixels in those levels. Returns 0 if the side length isn't valid; all
+ * textures must have at least the base mip level, and we can't hold more than
+ * KAC_1_0_MAX_NUM_MIP_LEVELS of them.*/
+static uint32_t texture_mip_chain_size(const uint32_t sideLength, uint32_t *const numPixels)
 {
-    return ((INPUT_FILE != NULL) &&
-            !ferror(INPUT_FILE) &&
-            !feof(INPUT_FILE));
+    uint32_t m = 0;
+
+    *numPixels = 0;
+
+    if ((sideLength < KAC_1_0_MIN_TEXTURE_SIDE_LENGTH) ||
+        (sideLength > KAC_1_0_MAX_TEXTURE_SIDE_LENGTH))
+    {
+        return 0;
+    }
+
+    for (m = 0; (sideLength >> m) >= KAC_1_0_MIN_TEXTURE_SIDE_LENGTH; m++)
+    {
+        *numPixels += ((sideLength >> m) * (sideLength >> m));
+    }
+
+    return m;
 }
 
-static int scan_input_file_structure(void)
+static int scan_input_file_structure(kac10_reader_t *const reader)
 {
     size_t byteOffset = 0;
 
-    assert(INPUT_FILE && "Attempting to scan a null input file.");
+    assert((reader->file || reader->data) && "Attempting to scan a null input file.");
 
     #define SEGMENT_IDENTIFIER_IS(name) (int)(strncmp((name), segmentIdentifier, 4) == 0)
 
-    #define SKIP_SEGMENT_DATA(elementByteSize) {uint32_t n = 0;\
-                                                fread((char*)&n, sizeof(n), 1, INPUT_FILE);\
-                                                fseek(INPUT_FILE, (n * (elementByteSize)), SEEK_CUR);\
-                                                byteOffset = ftell(INPUT_FILE);}
+    #define SKIP_SEGMENT_DATA(segmentId, elementByteSize) {uint32_t n = 0;\
+                                                input_read(reader, (char*)&n, sizeof(n));\
+                                                reader->segmentElementCounts[(segmentId)] = n;\
+                                                input_seek(reader, (n * (elementByteSize)), SEEK_CUR);\
+                                                byteOffset = input_tell(reader);}
 
     /* Loop through all segments in the file.*/
     while (1)
     {
         /* Note: The starting offset skips the 4-byte segment identifier.*/
-        const int32_t segmentStartingOffset = (ftell(INPUT_FILE) + 4);
+        const int32_t segmentStartingOffset = (input_tell(reader) + 4);
         char segmentIdentifier[4];
 
         assert((segmentStartingOffset != -1l) && "A call to ftell() failed.");
 
-        fread(segmentIdentifier, 1, 4, INPUT_FILE);
+        input_read(reader, segmentIdentifier, 4);
 
-        if (!kac10_reader__input_stream_is_valid())
+        if (!kac10_reader__input_stream_is_valid_r(reader))
         {
             fprintf(stderr, "ERROR: The KAC file is malformed\n");
             return 0;
@@ -85,12 +342,12 @@ static int scan_input_file_structure(void)
         {
             float fileFormatVersion = 0.0;
 
-            SEGMENTS_IN_FILE |= (1 << KAC_1_0_SEGMENT_ID_KAC);
-            SEGMENT_BYTE_OFFSETS[KAC_1_0_SEGMENT_ID_KAC] = segmentStartingOffset;
+            reader->segmentsInFile |= (1 << KAC_1_0_SEGMENT_ID_KAC);
+            reader->segmentByteOffsets[KAC_1_0_SEGMENT_ID_KAC] = segmentStartingOffset;
 
             /* TODO: Test that this segment is the first in the file.*/
 
-            fread((char*)&fileFormatVersion, sizeof(fileFormatVersion), 1, INPUT_FILE);
+            input_read(reader, (char*)&fileFormatVersion, sizeof(fileFormatVersion));
             if (fileFormatVersion != 1.0)
             {
                 fprintf(stderr, "ERROR: The KAC file is of version %f, but only version 1.0 "
@@ -100,8 +357,8 @@ static int scan_input_file_structure(void)
         }
         else if (SEGMENT_IDENTIFIER_IS("TXTR"))
         {
-            SEGMENTS_IN_FILE |= (1 << KAC_1_0_SEGMENT_ID_TXTR);
-            SEGMENT_BYTE_OFFSETS[KAC_1_0_SEGMENT_ID_TXTR] = segmentStartingOffset;
+            reader->segmentsInFile |= (1 << KAC_1_0_SEGMENT_ID_TXTR);
+            reader->segmentByteOffsets[KAC_1_0_SEGMENT_ID_TXTR] = segmentStartingOffset;
 
             /* TODO: Test to make sure this segment is the last in the file, as it should.*/
 
@@ -109,33 +366,33 @@ static int scan_input_file_structure(void)
         }
         else if (SEGMENT_IDENTIFIER_IS("MATE"))
         {
-            SEGMENTS_IN_FILE |= (1 << KAC_1_0_SEGMENT_ID_MATE);
-            SEGMENT_BYTE_OFFSETS[KAC_1_0_SEGMENT_ID_MATE] = segmentStartingOffset;
-            SKIP_SEGMENT_DATA(6);
+            reader->segmentsInFile |= (1 << KAC_1_0_SEGMENT_ID_MATE);
+            reader->segmentByteOffsets[KAC_1_0_SEGMENT_ID_MATE] = segmentStartingOffset;
+            SKIP_SEGMENT_DATA(KAC_1_0_SEGMENT_ID_MATE, 6);
         }
         else if (SEGMENT_IDENTIFIER_IS("VERT"))
         {
-            SEGMENTS_IN_FILE |= (1 << KAC_1_0_SEGMENT_ID_VERT);
-            SEGMENT_BYTE_OFFSETS[KAC_1_0_SEGMENT_ID_VERT] = segmentStartingOffset;
-            SKIP_SEGMENT_DATA(12);
+            reader->segmentsInFile |= (1 << KAC_1_0_SEGMENT_ID_VERT);
+            reader->segmentByteOffsets[KAC_1_0_SEGMENT_ID_VERT] = segmentStartingOffset;
+            SKIP_SEGMENT_DATA(KAC_1_0_SEGMENT_ID_VERT, 12);
         }
         else if (SEGMENT_IDENTIFIER_IS("NORM"))
         {
-            SEGMENTS_IN_FILE |= (1 << KAC_1_0_SEGMENT_ID_NORM);
-            SEGMENT_BYTE_OFFSETS[KAC_1_0_SEGMENT_ID_NORM] = segmentStartingOffset;
-            SKIP_SEGMENT_DATA(12);
+            reader->segmentsInFile |= (1 << KAC_1_0_SEGMENT_ID_NORM);
+            reader->segmentByteOffsets[KAC_1_0_SEGMENT_ID_NORM] = segmentStartingOffset;
+            SKIP_SEGMENT_DATA(KAC_1_0_SEGMENT_ID_NORM, 12);
         }
         else if (SEGMENT_IDENTIFIER_IS("UV  "))
         {
-            SEGMENTS_IN_FILE |= (1 << KAC_1_0_SEGMENT_ID_UV);
-            SEGMENT_BYTE_OFFSETS[KAC_1_0_SEGMENT_ID_UV] = segmentStartingOffset;
-            SKIP_SEGMENT_DATA(8);
+            reader->segmentsInFile |= (1 << KAC_1_0_SEGMENT_ID_UV);
+            reader->segmentByteOffsets[KAC_1_0_SEGMENT_ID_UV] = segmentStartingOffset;
+            SKIP_SEGMENT_DATA(KAC_1_0_SEGMENT_ID_UV, 8);
         }
         else if (SEGMENT_IDENTIFIER_IS("3MSH"))
         {
-            SEGMENTS_IN_FILE |= (1 << KAC_1_0_SEGMENT_ID_3MSH);
-            SEGMENT_BYTE_OFFSETS[KAC_1_0_SEGMENT_ID_3MSH] = segmentStartingOffset;
-            SKIP_SEGMENT_DATA(20);
+            reader->segmentsInFile |= (1 << KAC_1_0_SEGMENT_ID_3MSH);
+            reader->segmentByteOffsets[KAC_1_0_SEGMENT_ID_3MSH] = segmentStartingOffset;
+            SKIP_SEGMENT_DATA(KAC_1_0_SEGMENT_ID_3MSH, 20);
         }
         else
         {
@@ -153,7 +410,7 @@ static int scan_input_file_structure(void)
     {
         const uint32_t requiredSegments = (KAC_1_0_SEGMENT_ID_KAC | KAC_1_0_SEGMENT_ID_ENDS);
 
-        if ((SEGMENTS_IN_FILE & requiredSegments) != requiredSegments)
+        if ((reader->segmentsInFile & requiredSegments) != requiredSegments)
         {
             return 0;
         }
@@ -162,269 +419,2821 @@ static int scan_input_file_structure(void)
     return 1;
 }
 
-int kac10_reader__open_file(const char *const filename)
+/* Parses the given INDX segment data (which begin with the segment identifier
+ * and exclude the trailer), filling in the reader's segment and texture
+ * locations. Returns 1 if the index is valid; 0 otherwise.*/
+static int parse_index_segment(kac10_reader_t *const reader,
+                               const uint8_t *const index,
+                               const size_t indexByteSize,
+                               const uint32_t indexByteOffset)
 {
-    assert(!INPUT_FILE && "Attempting to open a new KAC file before closing the previous one.");
+    /* The segments that can appear in the index, and the byte sizes of their
+     * elements.*/
+    static const struct
+    {
+        const char *identifier;
+        unsigned segmentId;
+        uint32_t elementByteSize;
+    } segmentTypes[] = {{"KAC ", KAC_1_0_SEGMENT_ID_KAC,  0},
+                        {"MATE", KAC_1_0_SEGMENT_ID_MATE, 6},
+                        {"TXTR", KAC_1_0_SEGMENT_ID_TXTR, 0},
+                        {"VERT", KAC_1_0_SEGMENT_ID_VERT, 12},
+                        {"NORM", KAC_1_0_SEGMENT_ID_NORM, 12},
+                        {"UV  ", KAC_1_0_SEGMENT_ID_UV,   8},
+                        {"3MSH", KAC_1_0_SEGMENT_ID_3MSH, 20}};
+    const unsigned numSegmentTypes = (sizeof(segmentTypes) / sizeof(segmentTypes[0]));
+    const uint32_t requiredSegments = ((1 << KAC_1_0_SEGMENT_ID_KAC) | (1 << KAC_1_0_SEGMENT_ID_TXTR));
+    uint32_t i = 0, m = 0, numSegments = 0;
+    size_t indexPos = 4;
+
+    #define READ_INDEX_VALUE(dst) if ((indexByteSize - indexPos) < sizeof(dst)) return 0;\
+                                  memcpy((char*)&(dst), (index + indexPos), sizeof(dst));\
+                                  indexPos += sizeof(dst);
+
+    if ((indexByteSize < 4) ||
+        (strncmp((const char*)index, "INDX", 4) != 0))
+    {
+        return 0;
+    }
 
-    INPUT_FILE = fopen(filename, "rb");
-    SEGMENTS_IN_FILE = 0;
+    READ_INDEX_VALUE(numSegments);
 
-    return ((INPUT_FILE != NULL) &&
-            scan_input_file_structure());
-}
+    for (i = 0; i < numSegments; i++)
+    {
+        char identifier[4];
+        uint32_t byteOffset = 0, byteSize = 0;
+        unsigned t = 0;
 
-/* Closes the input file opened by kac10_reader__open_file().*/
-int kac10_reader__close_file(void)
-{
-    if (fclose(INPUT_FILE) == EOF)
+        READ_INDEX_VALUE(identifier);
+        READ_INDEX_VALUE(byteOffset);
+        READ_INDEX_VALUE(byteSize);
+
+        for (t = 0; t < numSegmentTypes; t++)
+        {
+            if (strncmp(segmentTypes[t].identifier, identifier, 4) == 0)
+            {
+                break;
+            }
+        }
+
+        if ((t == numSegmentTypes) ||
+            (byteSize < 8) ||
+            (byteOffset > indexByteOffset) ||
+            (byteSize > (indexByteOffset - byteOffset)))
+        {
+            return 0;
+        }
+
+        /* Note: The segment offsets we store skip the 4-byte segment identifier.*/
+        reader->segmentsInFile |= (1 << segmentTypes[t].segmentId);
+        reader->segmentByteOffsets[segmentTypes[t].segmentId] = (byteOffset + 4);
+
+        if (segmentTypes[t].elementByteSize)
+        {
+            if (((byteSize - 8) % segmentTypes[t].elementByteSize) != 0)
+            {
+                return 0;
+            }
+
+            reader->segmentElementCounts[segmentTypes[t].segmentId] = ((byteSize - 8) / segmentTypes[t].elementByteSize);
+        }
+    }
+
+    READ_INDEX_VALUE(reader->numTextures);
+
+    if (((reader->segmentsInFile & requiredSegments) != requiredSegments) ||
+        (reader->segmentByteOffsets[KAC_1_0_SEGMENT_ID_KAC] != 4) ||
+        (reader->numTextures > (indexByteSize / 8)) ||
+        !(reader->textureInfo = ALLOCATOR_CALLOC(reader->ownAllocator, (reader->numTextures + 1), sizeof(*reader->textureInfo))))
     {
         return 0;
     }
 
-    INPUT_FILE = NULL;
-    SEGMENTS_IN_FILE = 0;
+    for (i = 0; i < reader->numTextures; i++)
+    {
+        struct texture_info_s *const info = &reader->textureInfo[i];
+        uint32_t numMipLevels = 0, expectedByteOffset = 0;
+
+        READ_INDEX_VALUE(info->byteOffset);
+        READ_INDEX_VALUE(numMipLevels);
+
+        /* The mip levels' pixel data must follow the texture's 20 bytes of
+         * metadata back to back, and be of the sizes implied by the base
+         * level's side length.*/
+        expectedByteOffset = (info->byteOffset + 20);
+
+        for (m = 0; m < numMipLevels; m++)
+        {
+            uint32_t byteOffset = 0, byteSize = 0;
+
+            READ_INDEX_VALUE(byteOffset);
+            READ_INDEX_VALUE(byteSize);
+
+            if (!m)
+            {
+                for (info->sideLength = KAC_1_0_MIN_TEXTURE_SIDE_LENGTH;
+                     ((info->sideLength * info->sideLength * 2) < byteSize) &&
+                     (info->sideLength < KAC_1_0_MAX_TEXTURE_SIDE_LENGTH);
+                     info->sideLength *= 2);
+            }
+
+            if ((byteOffset != expectedByteOffset) ||
+                (byteSize != ((info->sideLength >> m) * (info->sideLength >> m) * 2)))
+            {
+                return 0;
+            }
+
+            expectedByteOffset += byteSize;
+        }
+
+        info->numMipLevels = texture_mip_chain_size(info->sideLength, &info->numPixels);
+
+        if (!info->numMipLevels ||
+            (info->numMipLevels != numMipLevels) ||
+            (expectedByteOffset > indexByteOffset))
+        {
+            return 0;
+        }
+    }
+
+    #undef READ_INDEX_VALUE
+
+    reader->texturesScanned = 1;
 
     return 1;
 }
 
-uint32_t kac10_reader__read_normals(struct kac_1_0_normal_s **normals)
+/* Looks for an INDX segment at the end of the file, and if there is one, takes
+ * the locations of the file's segments and textures from it rather than walking
+ * through the file. Returns 1 if a valid index was found. Otherwise, returns 0
+ * and rewinds the input, after which the file should be walked through with
+ * scan_input_file_structure().*/
+static int read_index_segment(kac10_reader_t *const reader)
 {
-    uint32_t i, numNormals = 0;
-
-    if (!kac10_reader__input_stream_is_valid() ||
-        !kac10_reader__file_has_normals())
+    uint32_t indexByteOffset = 0;
+    char identifier[4] = {0};
+    uint8_t *index = NULL;
+    long fileSize = 0;
+    int isValid = 0;
+
+    /* The index ends with a trailer of its byte offset in the file and the
+     * identifier "INDX". We read in the whole index at once, then parse it.*/
+    if ((input_seek(reader, -8, SEEK_END) == 0) &&
+        ((fileSize = (input_tell(reader) + 8)) >= 16))
     {
-        return 0;
+        input_read(reader, (char*)&indexByteOffset, sizeof(indexByteOffset));
+        input_read(reader, identifier, 4);
+
+        if (kac10_reader__input_stream_is_valid_r(reader) &&
+            (strncmp(identifier, "INDX", 4) == 0) &&
+            (indexByteOffset <= (uint32_t)(fileSize - 16)) &&
+            (index = ALLOCATOR_MALLOC(reader->ownAllocator, (fileSize - 8 - indexByteOffset))))
+        {
+            input_seek(reader, indexByteOffset, SEEK_SET);
+
+            isValid = ((input_read(reader, index, (fileSize - 8 - indexByteOffset)) == (size_t)(fileSize - 8 - indexByteOffset)) &&
+                       parse_index_segment(reader, index, (fileSize - 8 - indexByteOffset), indexByteOffset));
+
+            ALLOCATOR_FREE(reader->ownAllocator, index);
+        }
     }
 
-    fseek(INPUT_FILE, SEGMENT_BYTE_OFFSETS[KAC_1_0_SEGMENT_ID_NORM], SEEK_SET);
-    fread((char*)&numNormals, sizeof(numNormals), 1, INPUT_FILE);
+    /* Make sure that this is a KAC 1.0 file.*/
+    if (isValid)
+    {
+        float fileFormatVersion = 0.0;
+
+        input_seek(reader, 0, SEEK_SET);
+        input_read(reader, identifier, 4);
+        input_read(reader, (char*)&fileFormatVersion, sizeof(fileFormatVersion));
+
+        isValid = (kac10_reader__input_stream_is_valid_r(reader) &&
+                   (strncmp(identifier, "KAC ", 4) == 0) &&
+                   (fileFormatVersion == 1.0));
+    }
 
-    *normals = calloc(numNormals, sizeof(struct kac_1_0_normal_s));
-    for (i = 0; i < numNormals; i++)
+    if (!isValid)
     {
-        fread((char*)&(*normals)[i].x, sizeof((*normals)[i].x), 1, INPUT_FILE);
-        fread((char*)&(*normals)[i].y, sizeof((*normals)[i].y), 1, INPUT_FILE);
-        fread((char*)&(*normals)[i].z, sizeof((*normals)[i].z), 1, INPUT_FILE);
+        if (reader->textureInfo)
+        {
+            ALLOCATOR_FREE(reader->ownAllocator, reader->textureInfo);
+        }
+
+        reader->textureInfo = NULL;
+        reader->numTextures = 0;
+        reader->texturesScanned = 0;
+        reader->segmentsInFile = 0;
+        memset(reader->segmentByteOffsets, 0, sizeof(reader->segmentByteOffsets));
+        memset(reader->segmentElementCounts, 0, sizeof(reader->segmentElementCounts));
+
+        input_rewind(reader);
     }
 
-    return (kac10_reader__input_stream_is_valid()? numNormals : 0);
+    return isValid;
 }
 
-uint32_t kac10_reader__read_uv_coordinates(struct kac_1_0_uv_coordinates_s **uvCoords)
+kac10_reader_t* kac10_reader__open_file_r(const char *const filename)
 {
-    uint32_t i, numUVCoords = 0;
+    kac10_reader_t *const reader = ALLOCATOR_CALLOC(GLOBAL_ALLOCATOR, 1, sizeof(kac10_reader_t));
 
-    if (!kac10_reader__input_stream_is_valid() ||
-        !kac10_reader__file_has_uv_coordinates())
+    if (!reader)
     {
-        return 0;
+        return NULL;
     }
 
-    fseek(INPUT_FILE, SEGMENT_BYTE_OFFSETS[KAC_1_0_SEGMENT_ID_UV], SEEK_SET);
-    fread((char*)&numUVCoords, sizeof(numUVCoords), 1, INPUT_FILE);
+    reader->allocator = reader->ownAllocator = GLOBAL_ALLOCATOR;
+
+    reader->file = fopen(filename, "rb");
 
-    *uvCoords = calloc(numUVCoords, sizeof(struct kac_1_0_normal_s));
-    for (i = 0; i < numUVCoords; i++)
+    if (!reader->file ||
+        !(read_index_segment(reader) || scan_input_file_structure(reader)))
     {
-        fread((char*)&(*uvCoords)[i].u, sizeof((*uvCoords)[i].u), 1, INPUT_FILE);
-        fread((char*)&(*uvCoords)[i].v, sizeof((*uvCoords)[i].v), 1, INPUT_FILE);
+        kac10_reader__close_file_r(reader);
+        return NULL;
     }
 
-    return (kac10_reader__input_stream_is_valid()? numUVCoords : 0);
+    return reader;
 }
 
-uint32_t kac10_reader__read_textures(struct kac_1_0_texture_s **textures)
+kac10_reader_t* kac10_reader__open_file_mapped_r(const char *const filename)
 {
-    uint32_t i, numTextures = 0;
+    kac10_reader_t *const reader = ALLOCATOR_CALLOC(GLOBAL_ALLOCATOR, 1, sizeof(kac10_reader_t));
 
-    if (!kac10_reader__input_stream_is_valid() ||
-        !kac10_reader__file_has_textures())
+    if (!reader)
     {
-        return 0;
+        return NULL;
     }
 
-    fseek(INPUT_FILE, SEGMENT_BYTE_OFFSETS[KAC_1_0_SEGMENT_ID_TXTR], SEEK_SET);
-    fread((char*)&numTextures, sizeof(numTextures), 1, INPUT_FILE);
+    reader->allocator = reader->ownAllocator = GLOBAL_ALLOCATOR;
 
-    *textures = calloc(numTextures, sizeof(struct kac_1_0_texture_s));
-    
-    for (i = 0; i < numTextures; i++)
+    #ifdef KAC10_READER_HAS_MMAP
     {
-        /* Read the texture's metadata.*/
+        struct stat fileInfo;
+        void *mapping = MAP_FAILED;
+        const int fd = open(filename, O_RDONLY);
+
+        if (fd != -1)
         {
-            uint32_t parameters = 0;
-            uint8_t pixelHash[16] = {0};
+            if ((fstat(fd, &fileInfo) == 0) &&
+                (fileInfo.st_size > 0))
+            {
+                mapping = mmap(NULL, fileInfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            }
+
+            /* The mapping stays valid after the file descriptor has been closed.*/
+            close(fd);
+        }
 
-            fread((char*)&parameters, sizeof(parameters), 1, INPUT_FILE);
-            fread((char*)pixelHash, sizeof(pixelHash), 1, INPUT_FILE);
+        if (mapping != MAP_FAILED)
+        {
+            reader->data = mapping;
+            reader->dataSize = fileInfo.st_size;
+            reader->dataIsMmapped = 1;
+        }
+    }
+    #else
+    {
+        /* Without mmap(), we read the whole file into memory in one go.*/
+        FILE *const file = fopen(filename, "rb");
+        uint8_t *data = NULL;
+        long fileSize = 0;
 
-            (*textures)[i].metadata.sideLength     = ((parameters >>  0) & 0xffff);
-            (*textures)[i].metadata.sampleLinearly = ((parameters >> 16) & 0x1);
-            (*textures)[i].metadata.clampUV        = ((parameters >> 17) & 0x1);
+        if (file)
+        {
+            if ((fseek(file, 0, SEEK_END) == 0) &&
+                ((fileSize = ftell(file)) > 0) &&
+                (fseek(file, 0, SEEK_SET) == 0) &&
+                (data = ALLOCATOR_MALLOC(reader->ownAllocator, fileSize)) &&
+                (fread(data, 1, fileSize, file) != (size_t)fileSize))
+            {
+                ALLOCATOR_FREE(reader->ownAllocator, data);
+                data = NULL;
+            }
 
-            memcpy((*textures)[i].metadata.pixelHash, pixelHash, sizeof(pixelHash));
+            fclose(file);
         }
 
-        /* Read the texture's pixel data for all levels of mipmapping down to 1 x 1.*/
+        if (data)
         {
-            uint32_t m = 0, p = 0;
+            reader->data = data;
+            reader->dataSize = fileSize;
+            reader->dataIsMmapped = 0;
+        }
+    }
+    #endif
 
-            for (m = 0; ; m++)
-            {
-                const uint32_t mipLevelSideLength = ((*textures)[i].metadata.sideLength / pow(2, m));
-                const uint32_t texturePixelCount = (mipLevelSideLength * mipLevelSideLength);
+    if (!reader->data ||
+        !(read_index_segment(reader) || scan_input_file_structure(reader)))
+    {
+        kac10_reader__close_file_r(reader);
+        return NULL;
+    }
 
-                if (mipLevelSideLength < KAC_1_0_MIN_TEXTURE_SIDE_LENGTH)
-                {
-                    /* All textures must have at least the base mip level.*/
-                    if (!m)
-                    {
-                        return 0;
-                    }
+    return reader;
+}
 
-                    break;
-                }
+kac10_reader_t* kac10_reader__open_memory_r(const void *const data, const size_t byteSize)
+{
+    kac10_reader_t *const reader = ALLOCATOR_CALLOC(GLOBAL_ALLOCATOR, 1, sizeof(kac10_reader_t));
 
-                (*textures)[i].mipLevel[m] = malloc(texturePixelCount * sizeof(struct kac_1_0_texture_pixel_s));
-                (*textures)[i].numMipLevels = (m + 1);
+    if (!reader)
+    {
+        return NULL;
+    }
 
-                for (p = 0; p < texturePixelCount; p++)
-                {
-                    const uint16_t packedPixel = 0;
+    reader->allocator = reader->ownAllocator = GLOBAL_ALLOCATOR;
 
-                    fread((char*)&packedPixel, sizeof(packedPixel), 1, INPUT_FILE);
+    if (data && byteSize)
+    {
+        reader->data = data;
+        reader->dataSize = byteSize;
+        reader->dataIsExternal = 1;
+    }
 
-                    (*textures)[i].mipLevel[m][p].r = ((packedPixel >> 0)  & 0x1f);
-                    (*textures)[i].mipLevel[m][p].g = ((packedPixel >> 5)  & 0x1f);
-                    (*textures)[i].mipLevel[m][p].b = ((packedPixel >> 10) & 0x1f);
-                    (*textures)[i].mipLevel[m][p].a = ((packedPixel >> 15) & 0x1);
-                }
-            }
-        }
+    if (!reader->data ||
+        !(read_index_segment(reader) || scan_input_file_structure(reader)))
+    {
+        kac10_reader__close_file_r(reader);
+        return NULL;
     }
 
-    return (kac10_reader__input_stream_is_valid()? numTextures : 0);
+    return reader;
 }
 
-uint32_t kac10_reader__read_materials(struct kac_1_0_material_s **materials)
+kac10_reader_t* kac10_reader__duplicate_r(const kac10_reader_t *const reader)
 {
-    uint32_t i, numMaterials = 0;
+    kac10_reader_t *duplicate = NULL;
+
+    if (!reader ||
+        !reader->data ||
+        !(duplicate = ALLOCATOR_MALLOC(reader->ownAllocator, sizeof(kac10_reader_t))))
+    {
+        return NULL;
+    }
+
+    /* The duplicate reads the original's data in place, and shares the layout
+     * information that the original has gathered so far.*/
+    *duplicate = *reader;
+    duplicate->dataPos = 0;
+    duplicate->dataError = 0;
+    duplicate->dataIsMmapped = 0;
+    duplicate->dataIsExternal = 1;
+    duplicate->textureInfoIsBorrowed = (duplicate->textureInfo != NULL);
+
+    /* The original's cached segments aren't shared, as they may be freed.*/
+    memset(duplicate->segmentCache, 0, sizeof(duplicate->segmentCache));
+    memset(&duplicate->textureCache, 0, sizeof(duplicate->textureCache));
+
+    return duplicate;
+}
+
+int kac10_reader__close_file_r(kac10_reader_t *const reader)
+{
+    unsigned i = 0;
+    int success = 1;
 
-    if (!kac10_reader__input_stream_is_valid() ||
-        !kac10_reader__file_has_materials())
+    if (!reader)
     {
         return 0;
     }
 
-    fseek(INPUT_FILE, SEGMENT_BYTE_OFFSETS[KAC_1_0_SEGMENT_ID_MATE], SEEK_SET);
-    fread((char*)&numMaterials, sizeof(numMaterials), 1, INPUT_FILE);
+    if (reader->dataIsExternal)
+    {
+        /* The data are owned by the caller, who releases them.*/
+    }
+    else if (reader->data)
+    {
+        #ifdef KAC10_READER_HAS_MMAP
+            if (reader->dataIsMmapped &&
+                (munmap((void*)reader->data, reader->dataSize) != 0))
+            {
+                success = 0;
+            }
+        #endif
 
-    *materials = calloc(numMaterials, sizeof(struct kac_1_0_material_s));
-    for (i = 0; i < numMaterials; i++)
+        if (!reader->dataIsMmapped)
+        {
+            ALLOCATOR_FREE(reader->ownAllocator, (void*)reader->data);
+        }
+    }
+    else if (reader->file &&
+             (fclose(reader->file) == EOF))
     {
-        uint16_t packedColor = 0;
-        uint32_t metadata = 0;
+        success = 0;
+    }
 
-        fread((char*)&packedColor, sizeof(packedColor), 1, INPUT_FILE);
-        fread((char*)&metadata, sizeof(metadata), 1, INPUT_FILE);
+    for (i = 0; i < KAC_1_0_NUM_SEGMENTS; i++)
+    {
+        if (reader->segmentCache[i].isOwned)
+        {
+            ALLOCATOR_FREE(reader->ownAllocator, (void*)reader->segmentCache[i].data);
+        }
+    }
 
-        (*materials)[i].color.r = ((packedColor >>  0) & 0xf);
-        (*materials)[i].color.g = ((packedColor >>  4) & 0xf);
-        (*materials)[i].color.b = ((packedColor >>  8) & 0xf);
-        (*materials)[i].color.a = ((packedColor >> 12) & 0xf);
+    kac10_reader__free_texture_set(&reader->textureCache);
 
-        (*materials)[i].metadata.textureIdx          = ((metadata >>  0) & 0xffff);
-        (*materials)[i].metadata.hasTexture          = ((metadata >> 16) & 0x1);
-        (*materials)[i].metadata.hasSmoothShading    = ((metadata >> 17) & 0x1);
+    if (reader->textureInfo &&
+        !reader->textureInfoIsBorrowed)
+    {
+        ALLOCATOR_FREE(reader->ownAllocator, reader->textureInfo);
     }
 
-    return (kac10_reader__input_stream_is_valid()? numMaterials : 0);
+    ALLOCATOR_FREE(reader->ownAllocator, reader);
+
+    return success;
 }
 
-uint32_t kac10_reader__read_vertex_coordinates(struct kac_1_0_vertex_coordinates_s **vertexCoords)
+/* Reads the given segment's data into the given memory with a single read.
+ * This is for the segments whose on-disk records match their in-memory structs
+ * byte for byte (VERT, NORM, UV and 3MSH), so the data need no further decoding.
+ * Returns the number of elements read; or 0 if the segment doesn't exist, is
+ * empty, doesn't fit in 'dstByteSize' bytes, or there was a read error.*/
+static uint32_t read_segment_data_into(kac10_reader_t *const reader,
+                                       const unsigned segmentId,
+                                       const size_t elementByteSize,
+                                       void *const dst,
+                                       const size_t dstByteSize)
 {
-    uint32_t i, numVertexCoords = 0;
+    uint32_t numElements = 0;
 
-    if (!kac10_reader__input_stream_is_valid() ||
-        !kac10_reader__file_has_vertex_coordinates())
+    if (!kac10_reader__input_stream_is_valid_r(reader) ||
+        !(reader->segmentsInFile & (1 << segmentId)))
     {
         return 0;
     }
 
-    fseek(INPUT_FILE, SEGMENT_BYTE_OFFSETS[KAC_1_0_SEGMENT_ID_VERT], SEEK_SET);
-    fread((char*)&numVertexCoords, sizeof(numVertexCoords), 1, INPUT_FILE);
+    input_seek(reader, reader->segmentByteOffsets[segmentId], SEEK_SET);
+    input_read(reader, (char*)&numElements, sizeof(numElements));
+
+    if (!numElements ||
+        !kac10_reader__input_stream_is_valid_r(reader) ||
+        (numElements > (dstByteSize / elementByteSize)))
+    {
+        return 0;
+    }
 
-    *vertexCoords = calloc(numVertexCoords, sizeof(struct kac_1_0_vertex_coordinates_s));
-    for (i = 0; i < numVertexCoords; i++)
+    if ((input_read(reader, dst, (numElements * elementByteSize)) != (numElements * elementByteSize)) ||
+        !kac10_reader__input_stream_is_valid_r(reader))
     {
-        fread((char*)&(*vertexCoords)[i].x, sizeof((*vertexCoords)[i].x), 1, INPUT_FILE);
-        fread((char*)&(*vertexCoords)[i].y, sizeof((*vertexCoords)[i].y), 1, INPUT_FILE);
-        fread((char*)&(*vertexCoords)[i].z, sizeof((*vertexCoords)[i].z), 1, INPUT_FILE);
+        return 0;
     }
 
-    return (kac10_reader__input_stream_is_valid()? numVertexCoords : 0);
+    return numElements;
 }
 
-uint32_t kac10_reader__read_triangles(struct kac_1_0_triangle_s **triangles)
+/* Like read_segment_data_into(), but allocates the memory for the data, and
+ * points 'data' to it; or sets 'data' to NULL if nothing was read.*/
+static uint32_t read_segment_data(kac10_reader_t *const reader,
+                                  const unsigned segmentId,
+                                  const size_t elementByteSize,
+                                  void **data)
 {
-    uint32_t i, numTriangles = 0;
+    const uint32_t numElements = reader->segmentElementCounts[segmentId];
 
-    if (!kac10_reader__input_stream_is_valid() ||
-        !kac10_reader__file_has_vertex_coordinates())
+    *data = NULL;
+
+    if (!numElements ||
+        !(reader->segmentsInFile & (1 << segmentId)) ||
+        !(*data = ALLOCATOR_MALLOC(reader->allocator, (numElements * elementByteSize))))
     {
         return 0;
     }
 
-    fseek(INPUT_FILE, SEGMENT_BYTE_OFFSETS[KAC_1_0_SEGMENT_ID_3MSH], SEEK_SET);
-    fread((char*)&numTriangles, sizeof(numTriangles), 1, INPUT_FILE);
-
-    *triangles = calloc(numTriangles, sizeof(struct kac_1_0_triangle_s));
-    for (i = 0; i < numTriangles; i++)
+    if (read_segment_data_into(reader, segmentId, elementByteSize, *data, (numElements * elementByteSize)) != numElements)
     {
-        uint32_t v;
+        ALLOCATOR_FREE(reader->allocator, *data);
+        *data = NULL;
 
-        fread((char*)&(*triangles)[i].materialIdx, sizeof((*triangles)[i].materialIdx), 1, INPUT_FILE);
+        return 0;
+    }
 
-        for (v = 0; v < 3; v++)
-        {
-            struct kac_1_0_vertex_s *vertex = &(*triangles)[i].vertices[v];
+    return numElements;
+}
 
-            fread((char*)&vertex->vertexCoordinatesIdx, sizeof(vertex->vertexCoordinatesIdx), 1, INPUT_FILE);
-            fread((char*)&vertex->normalIdx, sizeof(vertex->normalIdx), 1, INPUT_FILE);
-            fread((char*)&vertex->uvIdx, sizeof(vertex->uvIdx), 1, INPUT_FILE);
-        }
-    }
+uint32_t kac10_reader__read_normals_into_r(kac10_reader_t *const reader,
+                                            struct kac_1_0_normal_s *const normals,
+                                            const size_t dstByteSize)
+{
+    return read_segment_data_into(reader, KAC_1_0_SEGMENT_ID_NORM, 12, normals, dstByteSize);
+}
+
+uint32_t kac10_reader__read_normals_r(kac10_reader_t *const reader, struct kac_1_0_normal_s **normals)
+{
+    void *data = NULL;
+    const uint32_t numNormals = read_segment_data(reader, KAC_1_0_SEGMENT_ID_NORM, 12, &data);
+
+    assert((sizeof(**normals) == 12) && "Unexpected padding in the normal struct.");
+
+    *normals = data;
 
-    return (kac10_reader__input_stream_is_valid()? numTriangles : 0);
+    return numNormals;
 }
 
-int kac10_reader__file_has_textures(void)
+uint32_t kac10_reader__read_uv_coordinates_into_r(kac10_reader_t *const reader,
+                                                   struct kac_1_0_uv_coordinates_s *const uvCoords,
+                                                   const size_t dstByteSize)
 {
-    return (SEGMENTS_IN_FILE & (1 << KAC_1_0_SEGMENT_ID_TXTR));
+    return read_segment_data_into(reader, KAC_1_0_SEGMENT_ID_UV, 8, uvCoords, dstByteSize);
 }
 
-int kac10_reader__file_has_normals(void)
+uint32_t kac10_reader__read_uv_coordinates_r(kac10_reader_t *const reader, struct kac_1_0_uv_coordinates_s **uvCoords)
+{
+    void *data = NULL;
+    const uint32_t numUVCoords = read_segment_data(reader, KAC_1_0_SEGMENT_ID_UV, 8, &data);
+
+    assert((sizeof(**uvCoords) == 8) && "Unexpected padding in the UV coordinates struct.");
+
+    *uvCoords = data;
+
+    return numUVCoords;
+}
+
+/* Unpacks the given number of 16-bit 5551 texture pixels (as stored in a KAC
+ * file) into the texture pixel struct.*/
+static void unpack_5551_pixels_scalar(const uint16_t *const src,
+                                      struct kac_1_0_texture_pixel_s *const dst,
+                                      const size_t numPixels)
+{
+    size_t p = 0;
+
+    for (p = 0; p < numPixels; p++)
+    {
+        dst[p].r = ((src[p] >> 0)  & 0x1f);
+        dst[p].g = ((src[p] >> 5)  & 0x1f);
+        dst[p].b = ((src[p] >> 10) & 0x1f);
+        dst[p].a = ((src[p] >> 15) & 0x1);
+    }
+
+    return;
+}
+
+/* Returns 1 if the compiler has laid out struct kac_1_0_texture_pixel_s as a
+ * 32-bit word holding the r, g, b and a bitfields in its lowest 16 bits in the
+ * same order as in a packed 5551 pixel (as e.g. GCC and Clang do on x86). An
+ * unpacked pixel is then simply the packed pixel zero-extended to 32 bits.*/
+static int pixel_struct_is_zero_extended_5551(void)
+{
+    struct kac_1_0_texture_pixel_s pixel;
+    uint32_t word = 0;
+
+    if (sizeof(pixel) != sizeof(word))
+    {
+        return 0;
+    }
+
+    memset(&pixel, 0, sizeof(pixel));
+    pixel.r = 0x1;
+    pixel.g = 0x2;
+    pixel.b = 0x4;
+    pixel.a = 0x1;
+    memcpy(&word, &pixel, sizeof(word));
+
+    return (word == (0x1 | (0x2 << 5) | (0x4 << 10) | (0x1 << 15)));
+}
+
+#ifdef KAC10_READER_HAS_X86_SIMD
+    /* SIMD versions of unpack_5551_pixels_scalar(), for when
+     * pixel_struct_is_zero_extended_5551() is true.*/
+    __attribute__((target("sse2")))
+    static void unpack_5551_pixels_sse2(const uint16_t *const src,
+                                        struct kac_1_0_texture_pixel_s *const dst,
+                                        const size_t numPixels)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        size_t p = 0;
+
+        for (p = 0; (p + 8) <= numPixels; p += 8)
+        {
+            const __m128i packed = _mm_loadu_si128((const __m128i*)(src + p));
+
+            _mm_storeu_si128((__m128i*)(dst + p),     _mm_unpacklo_epi16(packed, zero));
+            _mm_storeu_si128((__m128i*)(dst + p + 4), _mm_unpackhi_epi16(packed, zero));
+        }
+
+        unpack_5551_pixels_scalar((src + p), (dst + p), (numPixels - p));
+
+        return;
+    }
+
+    __attribute__((target("avx2")))
+    static void unpack_5551_pixels_avx2(const uint16_t *const src,
+                                        struct kac_1_0_texture_pixel_s *const dst,
+                                        const size_t numPixels)
+    {
+        size_t p = 0;
+
+        for (p = 0; (p + 16) <= numPixels; p += 16)
+        {
+            const __m128i packedLo = _mm_loadu_si128((const __m128i*)(src + p));
+            const __m128i packedHi = _mm_loadu_si128((const __m128i*)(src + p + 8));
+
+            _mm256_storeu_si256((__m256i*)(dst + p),     _mm256_cvtepu16_epi32(packedLo));
+            _mm256_storeu_si256((__m256i*)(dst + p + 8), _mm256_cvtepu16_epi32(packedHi));
+        }
+
+        unpack_5551_pixels_scalar((src + p), (dst + p), (numPixels - p));
+
+        return;
+    }
+#endif
+
+static void unpack_5551_pixels(const uint16_t *const src,
+                               struct kac_1_0_texture_pixel_s *const dst,
+                               const size_t numPixels)
+{
+    #ifdef KAC10_READER_HAS_X86_SIMD
+        if (pixel_struct_is_zero_extended_5551())
+        {
+            if (__builtin_cpu_supports("avx2"))
+            {
+                unpack_5551_pixels_avx2(src, dst, numPixels);
+                return;
+            }
+
+            if (__builtin_cpu_supports("sse2"))
+            {
+                unpack_5551_pixels_sse2(src, dst, numPixels);
+                return;
+            }
+        }
+    #endif
+
+    unpack_5551_pixels_scalar(src, dst, numPixels);
+
+    return;
+}
+
+/* Returns the given 16-bit value with a zero bit inserted above each of its
+ * bits, i.e. with bit n moved to bit 2n.*/
+static uint32_t spread_bits(uint32_t value)
+{
+    value = ((value | (value << 8)) & 0x00ff00ffu);
+    value = ((value | (value << 4)) & 0x0f0f0f0fu);
+    value = ((value | (value << 2)) & 0x33333333u);
+    value = ((value | (value << 1)) & 0x55555555u);
+
+    return value;
+}
+
+/* Computes where each pixel of a mip level of the given side length goes in
+ * memory in the given layout: the pixel at (x, y) goes at index
+ * (columnOffsets[x] + rowOffsets[y]).*/
+static void texture_layout_offsets(const enum kac10_texture_layout_e layout,
+                                   const uint32_t sideLength,
+                                   uint32_t *const columnOffsets,
+                                   uint32_t *const rowOffsets)
+{
+    uint32_t i = 0;
+
+    /* The layouts are defined only for power-of-two side lengths, as KAC 1.0
+     * requires; anything else is laid out row by row.*/
+    const int isPowerOfTwo = !(sideLength & (sideLength - 1));
+
+    for (i = 0; i < sideLength; i++)
+    {
+        if ((layout == KAC10_TEXTURE_LAYOUT_MORTON) && isPowerOfTwo)
+        {
+            columnOffsets[i] = spread_bits(i);
+            rowOffsets[i] = (spread_bits(i) << 1);
+        }
+        else if ((layout == KAC10_TEXTURE_LAYOUT_TILED_4X4) && isPowerOfTwo && (sideLength >= 4))
+        {
+            columnOffsets[i] = (((i / 4) * 16) + (i % 4));
+            rowOffsets[i] = (((i / 4) * (sideLength * 4)) + ((i % 4) * 4));
+        }
+        else
+        {
+            columnOffsets[i] = i;
+            rowOffsets[i] = (i * sideLength);
+        }
+    }
+
+    return;
+}
+
+/* Expands a 5-bit color channel to 8 bits, so that 0x1f maps to 0xff.*/
+#define EXPAND_5_TO_8(channel) (((channel) << 3) | ((channel) >> 2))
+
+/* Converts the given number of 16-bit 5551 texture pixels (as stored in a KAC
+ * file) into the given pixel format.*/
+static void convert_5551_pixels_scalar(const uint16_t *const src,
+                                       void *const dst,
+                                       const enum kac10_pixel_format_e format,
+                                       const size_t numPixels)
+{
+    size_t p = 0;
+
+    for (p = 0; p < numPixels; p++)
+    {
+        const uint32_t r = ((src[p] >> 0)  & 0x1f);
+        const uint32_t g = ((src[p] >> 5)  & 0x1f);
+        const uint32_t b = ((src[p] >> 10) & 0x1f);
+        const uint32_t a = ((src[p] >> 15) & 0x1);
+
+        switch (format)
+        {
+            case KAC10_PIXEL_FORMAT_RGBA8888:
+            {
+                uint8_t *const pixel = ((uint8_t*)dst + (p * 4));
+
+                pixel[0] = (uint8_t)EXPAND_5_TO_8(r);
+                pixel[1] = (uint8_t)EXPAND_5_TO_8(g);
+                pixel[2] = (uint8_t)EXPAND_5_TO_8(b);
+                pixel[3] = (uint8_t)(a? 0xff : 0);
+                break;
+            }
+            case KAC10_PIXEL_FORMAT_ARGB1555: ((uint16_t*)dst)[p] = (uint16_t)((a << 15) | (r << 10) | (g << 5) | b); break;
+            case KAC10_PIXEL_FORMAT_RGB565:   ((uint16_t*)dst)[p] = (uint16_t)((r << 11) | (((g << 1) | (g >> 4)) << 5) | b); break;
+            case KAC10_PIXEL_FORMAT_RGBA4444: ((uint16_t*)dst)[p] = (uint16_t)(((r >> 1) << 12) | ((g >> 1) << 8) | ((b >> 1) << 4) | (a? 0xf : 0)); break;
+            default: ((uint16_t*)dst)[p] = src[p]; break;
+        }
+    }
+
+    return;
+}
+
+#ifdef KAC10_READER_HAS_X86_SIMD
+    /* An SSE2 version of convert_5551_pixels_scalar(), converting eight pixels
+     * at a time.*/
+    __attribute__((target("sse2")))
+    static void convert_5551_pixels_sse2(const uint16_t *const src,
+                                         void *const dst,
+                                         const enum kac10_pixel_format_e format,
+                                         const size_t numPixels)
+    {
+        const __m128i mask5 = _mm_set1_epi16(0x1f);
+        size_t p = 0;
+
+        for (p = 0; (p + 8) <= numPixels; p += 8)
+        {
+            const __m128i packed = _mm_loadu_si128((const __m128i*)(src + p));
+            const __m128i r = _mm_and_si128(packed, mask5);
+            const __m128i g = _mm_and_si128(_mm_srli_epi16(packed, 5), mask5);
+            const __m128i b = _mm_and_si128(_mm_srli_epi16(packed, 10), mask5);
+            const __m128i a = _mm_srai_epi16(packed, 15); /* 0xffff if set, 0 otherwise.*/
+            __m128i converted = packed;
+
+            switch (format)
+            {
+                case KAC10_PIXEL_FORMAT_RGBA8888:
+                {
+                    const __m128i r8 = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+                    const __m128i g8 = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+                    const __m128i b8 = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+                    const __m128i rg = _mm_or_si128(r8, _mm_slli_epi16(g8, 8));
+                    const __m128i ba = _mm_or_si128(b8, _mm_slli_epi16(a, 8));
+
+                    _mm_storeu_si128((__m128i*)((uint8_t*)dst + (p * 4)),      _mm_unpacklo_epi16(rg, ba));
+                    _mm_storeu_si128((__m128i*)((uint8_t*)dst + (p * 4) + 16), _mm_unpackhi_epi16(rg, ba));
+                    continue;
+                }
+                case KAC10_PIXEL_FORMAT_ARGB1555:
+                {
+                    converted = _mm_or_si128(_mm_and_si128(packed, _mm_set1_epi16((short)0x83e0)),
+                                             _mm_or_si128(_mm_slli_epi16(r, 10), b));
+                    break;
+                }
+                case KAC10_PIXEL_FORMAT_RGB565:
+                {
+                    const __m128i g6 = _mm_or_si128(_mm_slli_epi16(g, 1), _mm_srli_epi16(g, 4));
+
+                    converted = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(r, 11), _mm_slli_epi16(g6, 5)), b);
+                    break;
+                }
+                case KAC10_PIXEL_FORMAT_RGBA4444:
+                {
+                    converted = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(_mm_srli_epi16(r, 1), 12),
+                                                          _mm_slli_epi16(_mm_srli_epi16(g, 1), 8)),
+                                             _mm_or_si128(_mm_slli_epi16(_mm_srli_epi16(b, 1), 4),
+                                                          _mm_and_si128(a, _mm_set1_epi16(0xf))));
+                    break;
+                }
+                default: break;
+            }
+
+            _mm_storeu_si128((__m128i*)((uint16_t*)dst + p), converted);
+        }
+
+        convert_5551_pixels_scalar((src + p),
+                                   ((uint8_t*)dst + (p * kac10_reader__pixel_format_byte_size(format))),
+                                   format,
+                                   (numPixels - p));
+
+        return;
+    }
+#endif
+
+static void convert_5551_pixels(const uint16_t *const src,
+                                void *const dst,
+                                const enum kac10_pixel_format_e format,
+                                const size_t numPixels)
+{
+    if (format == KAC10_PIXEL_FORMAT_KAC_5551)
+    {
+        memcpy(dst, src, (numPixels * sizeof(*src)));
+        return;
+    }
+
+    #ifdef KAC10_READER_HAS_X86_SIMD
+        if (__builtin_cpu_supports("sse2"))
+        {
+            convert_5551_pixels_sse2(src, dst, format, numPixels);
+            return;
+        }
+    #endif
+
+    convert_5551_pixels_scalar(src, dst, format, numPixels);
+
+    return;
+}
+
+unsigned kac10_reader__pixel_format_byte_size(const enum kac10_pixel_format_e format)
+{
+    return ((format == KAC10_PIXEL_FORMAT_RGBA8888)? 4 : 2);
+}
+
+/* Reads a mip level of the given side length from the current position in the
+ * input into the given memory, converting its pixels into the given format and
+ * placing them in the reader's texture layout.*/
+static void read_texture_mip_level(kac10_reader_t *const reader,
+                                   void *const dst,
+                                   const uint32_t sideLength,
+                                   const enum kac10_pixel_format_e format)
+{
+    /* The rows are read in and converted four at a time, then scattered into
+     * place (or, in the linear layout, converted directly into place).*/
+    uint16_t rows[4 * KAC_1_0_MAX_TEXTURE_SIDE_LENGTH];
+    uint16_t converted16[4 * KAC_1_0_MAX_TEXTURE_SIDE_LENGTH];
+    uint32_t converted32[4 * KAC_1_0_MAX_TEXTURE_SIDE_LENGTH];
+    uint32_t columnOffsets[KAC_1_0_MAX_TEXTURE_SIDE_LENGTH];
+    uint32_t rowOffsets[KAC_1_0_MAX_TEXTURE_SIDE_LENGTH];
+    const unsigned pixelByteSize = kac10_reader__pixel_format_byte_size(format);
+    const int isLinear = ((reader->textureLayout == KAC10_TEXTURE_LAYOUT_LINEAR) || (sideLength < 2));
+    uint32_t x = 0, y = 0, r = 0;
+
+    if ((isLinear && (format == KAC10_PIXEL_FORMAT_KAC_5551)) ||
+        (sideLength > KAC_1_0_MAX_TEXTURE_SIDE_LENGTH))
+    {
+        input_read(reader, (char*)dst, (sideLength * sideLength * sizeof(*rows)));
+        return;
+    }
+
+    texture_layout_offsets(reader->textureLayout, sideLength, columnOffsets, rowOffsets);
+
+    for (y = 0; y < sideLength; y += 4)
+    {
+        const uint32_t numRows = (((sideLength - y) < 4)? (sideLength - y) : 4);
+
+        if (input_read(reader, (char*)rows, (numRows * sideLength * sizeof(*rows))) != (numRows * sideLength * sizeof(*rows)))
+        {
+            return;
+        }
+
+        if (isLinear)
+        {
+            convert_5551_pixels(rows, ((uint8_t*)dst + (y * sideLength * pixelByteSize)), format, (numRows * sideLength));
+            continue;
+        }
+
+        convert_5551_pixels(rows, ((pixelByteSize == 4)? (void*)converted32 : (void*)converted16), format, (numRows * sideLength));
+
+        for (r = 0; r < numRows; r++)
+        {
+            const uint32_t srcRowIdx = (r * sideLength);
+
+            if (pixelByteSize == 4)
+            {
+                uint32_t *const dstRow = ((uint32_t*)dst + rowOffsets[y + r]);
+
+                for (x = 0; x < sideLength; x++)
+                {
+                    dstRow[columnOffsets[x]] = converted32[srcRowIdx + x];
+                }
+            }
+            else
+            {
+                uint16_t *const dstRow = ((uint16_t*)dst + rowOffsets[y + r]);
+
+                for (x = 0; x < sideLength; x++)
+                {
+                    dstRow[columnOffsets[x]] = converted16[srcRowIdx + x];
+                }
+            }
+        }
+    }
+
+    return;
+}
+
+/* Like unpack_5551_pixels(), but for a whole mip level of the given side
+ * length, placing the unpacked pixels in the reader's texture layout.*/
+static void unpack_5551_mip_level(const kac10_reader_t *const reader,
+                                  const uint16_t *const src,
+                                  struct kac_1_0_texture_pixel_s *const dst,
+                                  const uint32_t sideLength)
+{
+    uint32_t columnOffsets[KAC_1_0_MAX_TEXTURE_SIDE_LENGTH];
+    uint32_t rowOffsets[KAC_1_0_MAX_TEXTURE_SIDE_LENGTH];
+    uint32_t x = 0, y = 0;
+
+    if ((reader->textureLayout == KAC10_TEXTURE_LAYOUT_LINEAR) ||
+        (sideLength < 2) ||
+        (sideLength > KAC_1_0_MAX_TEXTURE_SIDE_LENGTH))
+    {
+        unpack_5551_pixels(src, dst, (sideLength * sideLength));
+        return;
+    }
+
+    texture_layout_offsets(reader->textureLayout, sideLength, columnOffsets, rowOffsets);
+
+    for (y = 0; y < sideLength; y++)
+    {
+        struct kac_1_0_texture_pixel_s *const dstRow = (dst + rowOffsets[y]);
+        const uint16_t *const srcRow = (src + (y * sideLength));
+
+        for (x = 0; x < sideLength; x++)
+        {
+            unpack_5551_pixels_scalar((srcRow + x), (dstRow + columnOffsets[x]), 1);
+        }
+    }
+
+    return;
+}
+
+/* Reads a texture's metadata from the current position in the input.*/
+static void read_texture_metadata(kac10_reader_t *const reader,
+                                  struct kac_1_0_texture_metadata_s *const metadata)
+{
+    uint32_t parameters = 0;
+    uint8_t pixelHash[16] = {0};
+
+    input_read(reader, (char*)&parameters, sizeof(parameters));
+    input_read(reader, (char*)pixelHash, sizeof(pixelHash));
+
+    metadata->sideLength     = ((parameters >>  0) & 0xffff);
+    metadata->sampleLinearly = ((parameters >> 16) & 0x1);
+    metadata->clampUV        = ((parameters >> 17) & 0x1);
+
+    memcpy(metadata->pixelHash, pixelHash, sizeof(pixelHash));
+
+    return;
+}
+
+/* Releases the given textures as read so far by kac10_reader__read_textures_r(),
+ * and sets the pointer to them to NULL.*/
+static void free_partial_textures(kac10_reader_t *const reader,
+                                  struct kac_1_0_texture_s **textures,
+                                  const uint32_t numTextures)
+{
+    uint32_t i, m;
+
+    for (i = 0; i < numTextures; i++)
+    {
+        for (m = 0; m < (*textures)[i].numMipLevels; m++)
+        {
+            if ((*textures)[i].mipLevel[m])
+            {
+                ALLOCATOR_FREE(reader->allocator, (*textures)[i].mipLevel[m]);
+            }
+        }
+    }
+
+    ALLOCATOR_FREE(reader->allocator, *textures);
+    *textures = NULL;
+
+    return;
+}
+
+uint32_t kac10_reader__read_textures_r(kac10_reader_t *const reader, struct kac_1_0_texture_s **textures)
+{
+    uint32_t i, numTextures = 0;
+    uint16_t *packedPixels = NULL;
+
+    if (!kac10_reader__input_stream_is_valid_r(reader) ||
+        !kac10_reader__file_has_textures_r(reader))
+    {
+        return 0;
+    }
+
+    input_seek(reader, reader->segmentByteOffsets[KAC_1_0_SEGMENT_ID_TXTR], SEEK_SET);
+    input_read(reader, (char*)&numTextures, sizeof(numTextures));
+
+    *textures = ALLOCATOR_CALLOC(reader->allocator, numTextures, sizeof(struct kac_1_0_texture_s));
+
+    /* Scratch memory for the packed pixels of one texture's full mip chain.*/
+    packedPixels = ALLOCATOR_MALLOC(reader->allocator, (KAC_1_0_MAX_TEXTURE_SIDE_LENGTH * KAC_1_0_MAX_TEXTURE_SIDE_LENGTH * 2 * sizeof(*packedPixels)));
+
+    if (!*textures || !packedPixels)
+    {
+        if (packedPixels)
+        {
+            ALLOCATOR_FREE(reader->allocator, packedPixels);
+        }
+
+        if (*textures)
+        {
+            free_partial_textures(reader, textures, numTextures);
+        }
+
+        return 0;
+    }
+    
+    for (i = 0; i < numTextures; i++)
+    {
+        uint32_t m = 0, numPixels = 0, numMipLevels = 0;
+
+        read_texture_metadata(reader, &(*textures)[i].metadata);
+
+        if (!(numMipLevels = texture_mip_chain_size((*textures)[i].metadata.sideLength, &numPixels)))
+        {
+            ALLOCATOR_FREE(reader->allocator, packedPixels);
+            free_partial_textures(reader, textures, numTextures);
+            return 0;
+        }
+
+        /* Read the texture's pixel data for all levels of mipmapping down to 1 x 1.
+         * The packed pixels of all levels are read in at once, then unpacked level
+         * by level.*/
+        input_read(reader, (char*)packedPixels, (numPixels * sizeof(*packedPixels)));
+
+        for (m = 0, numPixels = 0; m < numMipLevels; m++)
+        {
+            const uint32_t mipLevelSideLength = ((*textures)[i].metadata.sideLength >> m);
+            const uint32_t texturePixelCount = (mipLevelSideLength * mipLevelSideLength);
+
+            (*textures)[i].mipLevel[m] = ALLOCATOR_MALLOC(reader->allocator, (texturePixelCount * sizeof(struct kac_1_0_texture_pixel_s)));
+            (*textures)[i].numMipLevels = (m + 1);
+
+            if (!(*textures)[i].mipLevel[m])
+            {
+                ALLOCATOR_FREE(reader->allocator, packedPixels);
+                free_partial_textures(reader, textures, numTextures);
+                return 0;
+            }
+
+            unpack_5551_mip_level(reader, (packedPixels + numPixels), (*textures)[i].mipLevel[m], mipLevelSideLength);
+
+            numPixels += texturePixelCount;
+        }
+    }
+
+    ALLOCATOR_FREE(reader->allocator, packedPixels);
+
+    if (!kac10_reader__input_stream_is_valid_r(reader))
+    {
+        free_partial_textures(reader, textures, numTextures);
+        return 0;
+    }
+
+    return numTextures;
+}
+
+/* Releases the given textures as read so far by
+ * kac10_reader__read_packed_textures_r(), and sets the pointer to them to NULL.*/
+static void free_partial_packed_textures(kac10_reader_t *const reader,
+                                         struct kac_1_0_packed_texture_s **textures,
+                                         const uint32_t numTextures)
+{
+    uint32_t i, m;
+
+    for (i = 0; i < numTextures; i++)
+    {
+        for (m = 0; m < (*textures)[i].numMipLevels; m++)
+        {
+            if ((*textures)[i].mipLevel[m])
+            {
+                ALLOCATOR_FREE(reader->allocator, (*textures)[i].mipLevel[m]);
+            }
+        }
+    }
+
+    ALLOCATOR_FREE(reader->allocator, *textures);
+    *textures = NULL;
+
+    return;
+}
+
+uint32_t kac10_reader__read_packed_textures_r(kac10_reader_t *const reader, struct kac_1_0_packed_texture_s **textures)
+{
+    uint32_t i, numTextures = 0;
+
+    if (!kac10_reader__input_stream_is_valid_r(reader) ||
+        !kac10_reader__file_has_textures_r(reader))
+    {
+        return 0;
+    }
+
+    input_seek(reader, reader->segmentByteOffsets[KAC_1_0_SEGMENT_ID_TXTR], SEEK_SET);
+    input_read(reader, (char*)&numTextures, sizeof(numTextures));
+
+    if (!(*textures = ALLOCATOR_CALLOC(reader->allocator, numTextures, sizeof(struct kac_1_0_packed_texture_s))))
+    {
+        return 0;
+    }
+
+    for (i = 0; i < numTextures; i++)
+    {
+        uint32_t m = 0, numPixels = 0, numMipLevels = 0;
+
+        read_texture_metadata(reader, &(*textures)[i].metadata);
+
+        if (!(numMipLevels = texture_mip_chain_size((*textures)[i].metadata.sideLength, &numPixels)))
+        {
+            free_partial_packed_textures(reader, textures, numTextures);
+            return 0;
+        }
+
+        /* The pixels are stored in the file in the same format as in memory, so
+         * each mip level can be read in directly.*/
+        for (m = 0; m < numMipLevels; m++)
+        {
+            const uint32_t mipLevelSideLength = ((*textures)[i].metadata.sideLength >> m);
+            const uint32_t texturePixelCount = (mipLevelSideLength * mipLevelSideLength);
+
+            (*textures)[i].mipLevel[m] = ALLOCATOR_MALLOC(reader->allocator, (texturePixelCount * sizeof(kac_1_0_packed_texture_pixel_t)));
+            (*textures)[i].numMipLevels = (m + 1);
+
+            if (!(*textures)[i].mipLevel[m])
+            {
+                free_partial_packed_textures(reader, textures, numTextures);
+                return 0;
+            }
+
+            read_texture_mip_level(reader, (*textures)[i].mipLevel[m], mipLevelSideLength, KAC10_PIXEL_FORMAT_KAC_5551);
+        }
+    }
+
+    if (!kac10_reader__input_stream_is_valid_r(reader))
+    {
+        free_partial_packed_textures(reader, textures, numTextures);
+        return 0;
+    }
+
+    return numTextures;
+}
+
+/* Walks through the TXTR segment to find where each texture's data begin in
+ * the file and how large they are, storing the results in the reader. The walk
+ * is done only once per reader. Returns 1 on success; 0 otherwise.*/
+static int scan_texture_structure(kac10_reader_t *const reader)
+{
+    uint32_t i = 0;
+
+    if (reader->texturesScanned)
+    {
+        return 1;
+    }
+
+    if (!kac10_reader__input_stream_is_valid_r(reader) ||
+        !kac10_reader__file_has_textures_r(reader))
+    {
+        return 0;
+    }
+
+    input_seek(reader, reader->segmentByteOffsets[KAC_1_0_SEGMENT_ID_TXTR], SEEK_SET);
+    input_read(reader, (char*)&reader->numTextures, sizeof(reader->numTextures));
+
+    if (!kac10_reader__input_stream_is_valid_r(reader) ||
+        !(reader->textureInfo = ALLOCATOR_CALLOC(reader->ownAllocator, (reader->numTextures + 1), sizeof(*reader->textureInfo))))
+    {
+        return 0;
+    }
+
+    for (i = 0; i < reader->numTextures; i++)
+    {
+        struct texture_info_s *const info = &reader->textureInfo[i];
+        struct kac_1_0_texture_metadata_s metadata;
+
+        info->byteOffset = input_tell(reader);
+
+        read_texture_metadata(reader, &metadata);
+
+        info->sideLength = metadata.sideLength;
+        info->numMipLevels = texture_mip_chain_size(info->sideLength, &info->numPixels);
+
+        if (!info->numMipLevels ||
+            !kac10_reader__input_stream_is_valid_r(reader))
+        {
+            ALLOCATOR_FREE(reader->ownAllocator, reader->textureInfo);
+            reader->textureInfo = NULL;
+
+            return 0;
+        }
+
+        input_seek(reader, (info->numPixels * sizeof(kac_1_0_packed_texture_pixel_t)), SEEK_CUR);
+    }
+
+    reader->texturesScanned = 1;
+
+    return 1;
+}
+
+int kac10_reader__query_sizes_r(kac10_reader_t *const reader, struct kac10_segment_sizes_s *const sizes)
+{
+    uint32_t i = 0;
+    size_t inputByteSize = 0;
+
+    memset(sizes, 0, sizeof(*sizes));
+
+    if (!kac10_reader__input_stream_is_valid_r(reader) ||
+        (kac10_reader__file_has_textures_r(reader) && !scan_texture_structure(reader)))
+    {
+        return 0;
+    }
+
+    /* The element counts are as given in the file, so a corrupted count could
+     * have the caller allocate far more memory than the file could fill. The
+     * file is rejected if its segments don't fit in it.*/
+    inputByteSize = input_byte_size(reader);
+
+    if (!segment_fits_input(reader, KAC_1_0_SEGMENT_ID_NORM, 12, inputByteSize) ||
+        !segment_fits_input(reader, KAC_1_0_SEGMENT_ID_MATE, 6, inputByteSize) ||
+        !segment_fits_input(reader, KAC_1_0_SEGMENT_ID_3MSH, 20, inputByteSize) ||
+        !segment_fits_input(reader, KAC_1_0_SEGMENT_ID_UV, 8, inputByteSize) ||
+        !segment_fits_input(reader, KAC_1_0_SEGMENT_ID_VERT, 12, inputByteSize))
+    {
+        return 0;
+    }
+
+    if (reader->numTextures)
+    {
+        const struct texture_info_s *const lastTexture = &reader->textureInfo[reader->numTextures - 1];
+        const size_t pixelsByteOffset = ((size_t)lastTexture->byteOffset + 20);
+
+        if ((pixelsByteOffset > inputByteSize) ||
+            ((lastTexture->numPixels * sizeof(kac_1_0_packed_texture_pixel_t)) > (inputByteSize - pixelsByteOffset)))
+        {
+            return 0;
+        }
+    }
+
+    sizes->numNormals = reader->segmentElementCounts[KAC_1_0_SEGMENT_ID_NORM];
+    sizes->numMaterials = reader->segmentElementCounts[KAC_1_0_SEGMENT_ID_MATE];
+    sizes->numTriangles = reader->segmentElementCounts[KAC_1_0_SEGMENT_ID_3MSH];
+    sizes->numUVCoordinates = reader->segmentElementCounts[KAC_1_0_SEGMENT_ID_UV];
+    sizes->numVertexCoordinates = reader->segmentElementCounts[KAC_1_0_SEGMENT_ID_VERT];
+    sizes->numTextures = reader->numTextures;
+
+    sizes->normalsByteSize = (sizes->numNormals * sizeof(struct kac_1_0_normal_s));
+    sizes->materialsByteSize = (sizes->numMaterials * sizeof(struct kac_1_0_material_s));
+    sizes->trianglesByteSize = (sizes->numTriangles * sizeof(struct kac_1_0_triangle_s));
+    sizes->uvCoordinatesByteSize = (sizes->numUVCoordinates * sizeof(struct kac_1_0_uv_coordinates_s));
+    sizes->vertexCoordinatesByteSize = (sizes->numVertexCoordinates * sizeof(struct kac_1_0_vertex_coordinates_s));
+
+    for (i = 0; i < reader->numTextures; i++)
+    {
+        sizes->texturesByteSize += (reader->textureInfo[i].numPixels * sizeof(kac_1_0_packed_texture_pixel_t));
+    }
+
+    return 1;
+}
+
+int kac10_reader__query_texture_size_r(kac10_reader_t *const reader,
+                                       const uint32_t textureIdx,
+                                       struct kac10_texture_size_s *const size)
+{
+    uint32_t m = 0;
+
+    memset(size, 0, sizeof(*size));
+
+    if (!scan_texture_structure(reader) ||
+        (textureIdx >= reader->numTextures))
+    {
+        return 0;
+    }
+
+    size->sideLength = reader->textureInfo[textureIdx].sideLength;
+    size->numMipLevels = reader->textureInfo[textureIdx].numMipLevels;
+
+    for (m = 0; m < size->numMipLevels; m++)
+    {
+        const uint32_t mipLevelSideLength = (size->sideLength >> m);
+
+        size->mipLevelByteOffset[m] = size->byteSize;
+        size->mipLevelByteSize[m] = (mipLevelSideLength * mipLevelSideLength * sizeof(kac_1_0_packed_texture_pixel_t));
+        size->byteSize += size->mipLevelByteSize[m];
+    }
+
+    return 1;
+}
+
+uint32_t kac10_reader__read_converted_texture_into_r(kac10_reader_t *const reader,
+                                                     const uint32_t textureIdx,
+                                                     const enum kac10_pixel_format_e format,
+                                                     struct kac_1_0_texture_metadata_s *const metadata,
+                                                     void *const pixels,
+                                                     const size_t dstByteSize)
+{
+    const struct texture_info_s *info = NULL;
+    const unsigned pixelByteSize = kac10_reader__pixel_format_byte_size(format);
+    uint32_t m = 0;
+    size_t byteOffset = 0;
+
+    if (!scan_texture_structure(reader) ||
+        (textureIdx >= reader->numTextures))
+    {
+        return 0;
+    }
+
+    info = &reader->textureInfo[textureIdx];
+
+    if (((size_t)info->numPixels * pixelByteSize) > dstByteSize)
+    {
+        return 0;
+    }
+
+    input_seek(reader, info->byteOffset, SEEK_SET);
+    read_texture_metadata(reader, metadata);
+
+    for (m = 0; m < info->numMipLevels; m++)
+    {
+        const uint32_t mipLevelSideLength = (info->sideLength >> m);
+
+        read_texture_mip_level(reader, ((uint8_t*)pixels + byteOffset), mipLevelSideLength, format);
+
+        byteOffset += (mipLevelSideLength * mipLevelSideLength * pixelByteSize);
+    }
+
+    return (kac10_reader__input_stream_is_valid_r(reader)? info->numMipLevels : 0);
+}
+
+uint32_t kac10_reader__read_texture_into_r(kac10_reader_t *const reader,
+                                           const uint32_t textureIdx,
+                                           struct kac_1_0_texture_metadata_s *const metadata,
+                                           kac_1_0_packed_texture_pixel_t *const pixels,
+                                           const size_t dstByteSize)
+{
+    return kac10_reader__read_converted_texture_into_r(reader, textureIdx, KAC10_PIXEL_FORMAT_KAC_5551, metadata, pixels, dstByteSize);
+}
+
+/* Validates the given mip level range of the given texture, clamping the last
+ * level to the texture's mip chain, and seeks the input to the start of the
+ * first level's pixel data. Returns the number of mip levels in the range; or
+ * 0 if the range is invalid.*/
+static uint32_t seek_texture_mip_range(kac10_reader_t *const reader,
+                                       const uint32_t textureIdx,
+                                       const uint32_t firstMipLevel,
+                                       uint32_t *const lastMipLevel,
+                                       struct kac_1_0_texture_metadata_s *const metadata)
+{
+    const struct texture_info_s *info = NULL;
+    uint32_t m = 0, pixelOffset = 0;
+
+    if (!scan_texture_structure(reader) ||
+        (textureIdx >= reader->numTextures))
+    {
+        return 0;
+    }
+
+    info = &reader->textureInfo[textureIdx];
+
+    if (*lastMipLevel >= info->numMipLevels)
+    {
+        *lastMipLevel = (info->numMipLevels - 1);
+    }
+
+    if (firstMipLevel > *lastMipLevel)
+    {
+        return 0;
+    }
+
+    for (m = 0; m < firstMipLevel; m++)
+    {
+        pixelOffset += ((info->sideLength >> m) * (info->sideLength >> m));
+    }
+
+    input_seek(reader, info->byteOffset, SEEK_SET);
+    read_texture_metadata(reader, metadata);
+    input_seek(reader, (pixelOffset * sizeof(kac_1_0_packed_texture_pixel_t)), SEEK_CUR);
+
+    return (kac10_reader__input_stream_is_valid_r(reader)? (*lastMipLevel - firstMipLevel + 1) : 0);
+}
+
+uint32_t kac10_reader__read_texture_r(kac10_reader_t *const reader,
+                                      const uint32_t textureIdx,
+                                      const uint32_t firstMipLevel,
+                                      const uint32_t lastMipLevel,
+                                      struct kac_1_0_texture_s *const texture)
+{
+    uint32_t m = 0, numPixels = 0, numMipLevelsRead = 0, lastLevel = lastMipLevel;
+    uint16_t *packedPixels = NULL;
+
+    memset(texture, 0, sizeof(*texture));
+
+    if (!(numMipLevelsRead = seek_texture_mip_range(reader, textureIdx, firstMipLevel, &lastLevel, &texture->metadata)))
+    {
+        return 0;
+    }
+
+    texture->numMipLevels = reader->textureInfo[textureIdx].numMipLevels;
+
+    /* The packed pixels of the range's levels are contiguous in the file, so
+     * they're read in at once, then unpacked level by level.*/
+    for (m = firstMipLevel; m <= lastLevel; m++)
+    {
+        numPixels += ((texture->metadata.sideLength >> m) * (texture->metadata.sideLength >> m));
+    }
+
+    if (!(packedPixels = ALLOCATOR_MALLOC(reader->allocator, (numPixels * sizeof(*packedPixels)))))
+    {
+        return 0;
+    }
+
+    input_read(reader, (char*)packedPixels, (numPixels * sizeof(*packedPixels)));
+
+    for (m = firstMipLevel, numPixels = 0; m <= lastLevel; m++)
+    {
+        const uint32_t mipLevelSideLength = (texture->metadata.sideLength >> m);
+        const uint32_t texturePixelCount = (mipLevelSideLength * mipLevelSideLength);
+
+        if (!(texture->mipLevel[m] = ALLOCATOR_MALLOC(reader->allocator, (texturePixelCount * sizeof(struct kac_1_0_texture_pixel_s)))))
+        {
+            numMipLevelsRead = 0;
+            break;
+        }
+
+        unpack_5551_mip_level(reader, (packedPixels + numPixels), texture->mipLevel[m], mipLevelSideLength);
+
+        numPixels += texturePixelCount;
+    }
+
+    ALLOCATOR_FREE(reader->allocator, packedPixels);
+
+    if (!numMipLevelsRead ||
+        !kac10_reader__input_stream_is_valid_r(reader))
+    {
+        for (m = firstMipLevel; m <= lastLevel; m++)
+        {
+            if (texture->mipLevel[m])
+            {
+                ALLOCATOR_FREE(reader->allocator, texture->mipLevel[m]);
+                texture->mipLevel[m] = NULL;
+            }
+        }
+
+        return 0;
+    }
+
+    return numMipLevelsRead;
+}
+
+uint32_t kac10_reader__read_packed_texture_r(kac10_reader_t *const reader,
+                                             const uint32_t textureIdx,
+                                             const uint32_t firstMipLevel,
+                                             const uint32_t lastMipLevel,
+                                             struct kac_1_0_packed_texture_s *const texture)
+{
+    uint32_t m = 0, numMipLevelsRead = 0, lastLevel = lastMipLevel;
+
+    memset(texture, 0, sizeof(*texture));
+
+    if (!(numMipLevelsRead = seek_texture_mip_range(reader, textureIdx, firstMipLevel, &lastLevel, &texture->metadata)))
+    {
+        return 0;
+    }
+
+    texture->numMipLevels = reader->textureInfo[textureIdx].numMipLevels;
+
+    for (m = firstMipLevel; m <= lastLevel; m++)
+    {
+        const uint32_t mipLevelSideLength = (texture->metadata.sideLength >> m);
+        const uint32_t mipLevelByteSize = (mipLevelSideLength * mipLevelSideLength * sizeof(kac_1_0_packed_texture_pixel_t));
+
+        if (!(texture->mipLevel[m] = ALLOCATOR_MALLOC(reader->allocator, mipLevelByteSize)))
+        {
+            numMipLevelsRead = 0;
+            break;
+        }
+
+        read_texture_mip_level(reader, texture->mipLevel[m], mipLevelSideLength, KAC10_PIXEL_FORMAT_KAC_5551);
+    }
+
+    if (!numMipLevelsRead ||
+        !kac10_reader__input_stream_is_valid_r(reader))
+    {
+        for (m = firstMipLevel; m <= lastLevel; m++)
+        {
+            if (texture->mipLevel[m])
+            {
+                ALLOCATOR_FREE(reader->allocator, texture->mipLevel[m]);
+                texture->mipLevel[m] = NULL;
+            }
+        }
+
+        return 0;
+    }
+
+    return numMipLevelsRead;
+}
+
+uint32_t kac10_reader__prepare_texture_set_r(kac10_reader_t *const reader, struct kac10_texture_set_s *const textureSet)
+{
+    uint32_t i = 0, m = 0;
+    size_t arenaSize = 0, arenaPos = 0;
+    uint8_t *arena = NULL;
+
+    memset(textureSet, 0, sizeof(*textureSet));
+
+    if (!scan_texture_structure(reader) ||
+        !reader->numTextures)
+    {
+        return 0;
+    }
+
+    /* Lay out the arena: the texture structs first, followed by the pixel data
+     * of each mip level of each texture, each starting on an aligned boundary.*/
+    arenaSize = ARENA_ALIGNED_SIZE(reader->numTextures * sizeof(struct kac_1_0_packed_texture_s));
+    for (i = 0; i < reader->numTextures; i++)
+    {
+        for (m = 0; m < reader->textureInfo[i].numMipLevels; m++)
+        {
+            const uint32_t mipLevelSideLength = (reader->textureInfo[i].sideLength >> m);
+
+            arenaSize += ARENA_ALIGNED_SIZE(mipLevelSideLength * mipLevelSideLength * sizeof(kac_1_0_packed_texture_pixel_t));
+        }
+    }
+
+    textureSet->allocator = reader->allocator;
+
+    if (!(textureSet->memory = ALLOCATOR_MALLOC(textureSet->allocator, (arenaSize + (KAC10_READER_ARENA_ALIGNMENT - 1)))))
+    {
+        return 0;
+    }
+
+    arena = (uint8_t*)ARENA_ALIGNED_SIZE((uintptr_t)textureSet->memory);
+    textureSet->textures = (struct kac_1_0_packed_texture_s*)arena;
+    arenaPos = ARENA_ALIGNED_SIZE(reader->numTextures * sizeof(struct kac_1_0_packed_texture_s));
+
+    for (i = 0; i < reader->numTextures; i++)
+    {
+        struct kac_1_0_packed_texture_s *const texture = &textureSet->textures[i];
+
+        memset(texture, 0, sizeof(*texture));
+
+        for (m = 0; m < reader->textureInfo[i].numMipLevels; m++)
+        {
+            const uint32_t mipLevelSideLength = (reader->textureInfo[i].sideLength >> m);
+
+            texture->mipLevel[m] = (kac_1_0_packed_texture_pixel_t*)(arena + arenaPos);
+            texture->numMipLevels = (m + 1);
+
+            arenaPos += ARENA_ALIGNED_SIZE(mipLevelSideLength * mipLevelSideLength * sizeof(kac_1_0_packed_texture_pixel_t));
+        }
+    }
+
+    textureSet->numTextures = reader->numTextures;
+
+    return textureSet->numTextures;
+}
+
+uint32_t kac10_reader__fill_texture_set_r(kac10_reader_t *const reader,
+                                          struct kac10_texture_set_s *const textureSet,
+                                          const uint32_t firstTextureIdx,
+                                          const uint32_t numTextures)
+{
+    uint32_t i = 0, m = 0;
+
+    if (!scan_texture_structure(reader) ||
+        (textureSet->numTextures != reader->numTextures) ||
+        (firstTextureIdx > reader->numTextures) ||
+        (numTextures > (reader->numTextures - firstTextureIdx)))
+    {
+        return 0;
+    }
+
+    for (i = firstTextureIdx; i < (firstTextureIdx + numTextures); i++)
+    {
+        struct kac_1_0_packed_texture_s *const texture = &textureSet->textures[i];
+
+        input_seek(reader, reader->textureInfo[i].byteOffset, SEEK_SET);
+        read_texture_metadata(reader, &texture->metadata);
+
+        for (m = 0; m < texture->numMipLevels; m++)
+        {
+            const uint32_t mipLevelSideLength = (reader->textureInfo[i].sideLength >> m);
+
+            read_texture_mip_level(reader, texture->mipLevel[m], mipLevelSideLength, KAC10_PIXEL_FORMAT_KAC_5551);
+        }
+    }
+
+    return (kac10_reader__input_stream_is_valid_r(reader)? numTextures : 0);
+}
+
+uint32_t kac10_reader__read_texture_set_r(kac10_reader_t *const reader, struct kac10_texture_set_s *const textureSet)
+{
+    if (!kac10_reader__prepare_texture_set_r(reader, textureSet))
+    {
+        return 0;
+    }
+
+    if (kac10_reader__fill_texture_set_r(reader, textureSet, 0, textureSet->numTextures) != textureSet->numTextures)
+    {
+        kac10_reader__free_texture_set(textureSet);
+        return 0;
+    }
+
+    return textureSet->numTextures;
+}
+
+void kac10_reader__free_texture_set(struct kac10_texture_set_s *const textureSet)
+{
+    if (textureSet->memory)
+    {
+        ALLOCATOR_FREE(textureSet->allocator, textureSet->memory);
+    }
+
+    memset(textureSet, 0, sizeof(*textureSet));
+
+    return;
+}
+
+uint32_t kac10_reader__read_materials_into_r(kac10_reader_t *const reader,
+                                             struct kac_1_0_material_s *const materials,
+                                             const size_t dstByteSize)
+{
+    uint32_t i, numMaterials = 0;
+
+    /* Each packed material is 6 bytes: a 16-bit color and 32 bits of metadata.
+     * We read them in in batches, unpacking each batch in turn.*/
+    uint8_t packedMaterials[6 * 256];
+
+    if (!kac10_reader__input_stream_is_valid_r(reader) ||
+        !kac10_reader__file_has_materials_r(reader))
+    {
+        return 0;
+    }
+
+    input_seek(reader, reader->segmentByteOffsets[KAC_1_0_SEGMENT_ID_MATE], SEEK_SET);
+    input_read(reader, (char*)&numMaterials, sizeof(numMaterials));
+
+    if (!numMaterials ||
+        !kac10_reader__input_stream_is_valid_r(reader) ||
+        (numMaterials > (dstByteSize / sizeof(struct kac_1_0_material_s))))
+    {
+        return 0;
+    }
+
+    for (i = 0; i < numMaterials; i++)
+    {
+        const uint8_t *const packedMaterial = (packedMaterials + ((i % 256) * 6));
+        uint16_t packedColor = 0;
+        uint32_t metadata = 0;
+
+        if (!(i % 256))
+        {
+            const uint32_t batchSize = (((numMaterials - i) < 256)? (numMaterials - i) : 256);
+
+            if (input_read(reader, packedMaterials, (batchSize * 6)) != (batchSize * 6))
+            {
+                return 0;
+            }
+        }
+
+        memcpy((char*)&packedColor, packedMaterial, sizeof(packedColor));
+        memcpy((char*)&metadata, (packedMaterial + 2), sizeof(metadata));
+
+        memset(&materials[i], 0, sizeof(materials[i]));
+
+        materials[i].color.r = ((packedColor >>  0) & 0xf);
+        materials[i].color.g = ((packedColor >>  4) & 0xf);
+        materials[i].color.b = ((packedColor >>  8) & 0xf);
+        materials[i].color.a = ((packedColor >> 12) & 0xf);
+
+        materials[i].metadata.textureIdx          = ((metadata >>  0) & 0xffff);
+        materials[i].metadata.hasTexture          = ((metadata >> 16) & 0x1);
+        materials[i].metadata.hasSmoothShading    = ((metadata >> 17) & 0x1);
+    }
+
+    return (kac10_reader__input_stream_is_valid_r(reader)? numMaterials : 0);
+}
+
+uint32_t kac10_reader__read_materials_r(kac10_reader_t *const reader, struct kac_1_0_material_s **materials)
+{
+    const uint32_t numMaterials = reader->segmentElementCounts[KAC_1_0_SEGMENT_ID_MATE];
+
+    if (!numMaterials ||
+        !kac10_reader__file_has_materials_r(reader) ||
+        !(*materials = ALLOCATOR_MALLOC(reader->allocator, (numMaterials * sizeof(struct kac_1_0_material_s)))))
+    {
+        return 0;
+    }
+
+    if (kac10_reader__read_materials_into_r(reader, *materials, (numMaterials * sizeof(struct kac_1_0_material_s))) != numMaterials)
+    {
+        ALLOCATOR_FREE(reader->allocator, *materials);
+        *materials = NULL;
+
+        return 0;
+    }
+
+    return numMaterials;
+}
+
+uint32_t kac10_reader__read_vertex_coordinates_into_r(kac10_reader_t *const reader,
+                                                       struct kac_1_0_vertex_coordinates_s *const vertexCoords,
+                                                       const size_t dstByteSize)
+{
+    return read_segment_data_into(reader, KAC_1_0_SEGMENT_ID_VERT, 12, vertexCoords, dstByteSize);
+}
+
+uint32_t kac10_reader__read_vertex_coordinates_r(kac10_reader_t *const reader, struct kac_1_0_vertex_coordinates_s **vertexCoords)
+{
+    void *data = NULL;
+    const uint32_t numVertexCoords = read_segment_data(reader, KAC_1_0_SEGMENT_ID_VERT, 12, &data);
+
+    assert((sizeof(**vertexCoords) == 12) && "Unexpected padding in the vertex coordinates struct.");
+
+    *vertexCoords = data;
+
+    return numVertexCoords;
+}
+
+uint32_t kac10_reader__read_triangles_into_r(kac10_reader_t *const reader,
+                                              struct kac_1_0_triangle_s *const triangles,
+                                              const size_t dstByteSize)
+{
+    return read_segment_data_into(reader, KAC_1_0_SEGMENT_ID_3MSH, 20, triangles, dstByteSize);
+}
+
+uint32_t kac10_reader__read_triangles_r(kac10_reader_t *const reader, struct kac_1_0_triangle_s **triangles)
+{
+    void *data = NULL;
+    const uint32_t numTriangles = read_segment_data(reader, KAC_1_0_SEGMENT_ID_3MSH, 20, &data);
+
+    assert((sizeof(**triangles) == 20) && "Unexpected padding in the triangle struct.");
+
+    *triangles = data;
+
+    return numTriangles;
+}
+
+/* Copies the given number of vectors of 'numComponents' (2 or 3) interleaved
+ * floats into separate arrays per component.*/
+static void deinterleave_floats_scalar(const float *const src,
+                                       float *const *const dst,
+                                       const unsigned numComponents,
+                                       const size_t numVectors)
+{
+    size_t i = 0;
+    unsigned c = 0;
+
+    for (i = 0; i < numVectors; i++)
+    {
+        for (c = 0; c < numComponents; c++)
+        {
+            dst[c][i] = src[(i * numComponents) + c];
+        }
+    }
+
+    return;
+}
+
+#ifdef KAC10_READER_HAS_X86_SIMD
+    /* An SSE2 version of deinterleave_floats_scalar(), handling four vectors at
+     * a time. The destination arrays must be 16-byte aligned.*/
+    __attribute__((target("sse2")))
+    static void deinterleave_floats_sse2(const float *const src,
+                                         float *const *const dst,
+                                         const unsigned numComponents,
+                                         const size_t numVectors)
+    {
+        size_t i = 0;
+
+        if (numComponents == 3)
+        {
+            for (i = 0; (i + 4) <= numVectors; i += 4)
+            {
+                /* a = x0 y0 z0 x1, b = y1 z1 x2 y2, c = z2 x3 y3 z3.*/
+                const __m128 a = _mm_loadu_ps(src + (i * 3));
+                const __m128 b = _mm_loadu_ps(src + (i * 3) + 4);
+                const __m128 c = _mm_loadu_ps(src + (i * 3) + 8);
+                const __m128 x2x3 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+                const __m128 y0y1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1));
+                const __m128 y2y3 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3));
+                const __m128 z0z1 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2));
+
+                _mm_store_ps((dst[0] + i), _mm_shuffle_ps(a, x2x3, _MM_SHUFFLE(2, 0, 3, 0)));
+                _mm_store_ps((dst[1] + i), _mm_shuffle_ps(y0y1, y2y3, _MM_SHUFFLE(2, 0, 2, 0)));
+                _mm_store_ps((dst[2] + i), _mm_shuffle_ps(z0z1, c, _MM_SHUFFLE(3, 0, 2, 0)));
+            }
+        }
+        else if (numComponents == 2)
+        {
+            for (i = 0; (i + 4) <= numVectors; i += 4)
+            {
+                /* a = u0 v0 u1 v1, b = u2 v2 u3 v3.*/
+                const __m128 a = _mm_loadu_ps(src + (i * 2));
+                const __m128 b = _mm_loadu_ps(src + (i * 2) + 4);
+
+                _mm_store_ps((dst[0] + i), _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+                _mm_store_ps((dst[1] + i), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+            }
+        }
+
+        {
+            float *dstTail[3];
+
+            dstTail[0] = (dst[0] + i);
+            dstTail[1] = (dst[1] + i);
+            dstTail[2] = ((numComponents > 2)? (dst[2] + i) : NULL);
+
+            deinterleave_floats_scalar((src + (i * numComponents)), dstTail, numComponents, (numVectors - i));
+        }
+
+        return;
+    }
+#endif
+
+static void deinterleave_floats(const float *const src,
+                                float *const *const dst,
+                                const unsigned numComponents,
+                                const size_t numVectors)
+{
+    #ifdef KAC10_READER_HAS_X86_SIMD
+        if (__builtin_cpu_supports("sse2"))
+        {
+            deinterleave_floats_sse2(src, dst, numComponents, numVectors);
+            return;
+        }
+    #endif
+
+    deinterleave_floats_scalar(src, dst, numComponents, numVectors);
+
+    return;
+}
+
+/* Reads the given segment, whose elements are vectors of 'numComponents' (2 or
+ * 3) floats, into separate arrays per component, as described for struct
+ * kac10_soa_vectors_s. Returns the number of vectors read; or 0 if the segment
+ * doesn't exist, is empty, or there was a read error.*/
+static uint32_t read_segment_data_soa(kac10_reader_t *const reader,
+                                      const unsigned segmentId,
+                                      const unsigned numComponents,
+                                      struct kac10_soa_vectors_s *const vectors)
+{
+    /* The vectors are read in in batches, each of which is then deinterleaved
+     * into the component arrays. The batch size is a multiple of 4, so that
+     * each batch starts on a 16-byte boundary in the arrays.*/
+    float batch[3 * 1024];
+    float *components[3] = {NULL, NULL, NULL};
+    const uint32_t numElements = reader->segmentElementCounts[segmentId];
+    size_t arrayByteSize = 0;
+    uint32_t i = 0, numVectors = 0;
+    unsigned c = 0;
+
+    memset(vectors, 0, sizeof(*vectors));
+    vectors->allocator = reader->allocator;
+
+    if (!numElements ||
+        !kac10_reader__input_stream_is_valid_r(reader) ||
+        !(reader->segmentsInFile & (1 << segmentId)) ||
+        !segment_fits_input(reader, segmentId, (numComponents * sizeof(float)), input_byte_size(reader)))
+    {
+        return 0;
+    }
+
+    arrayByteSize = ((((size_t)numElements * sizeof(float)) + (KAC10_READER_SOA_ALIGNMENT - 1)) &
+                     ~(size_t)(KAC10_READER_SOA_ALIGNMENT - 1));
+
+    if (!(vectors->memory = ALLOCATOR_MALLOC(reader->allocator, ((numComponents * arrayByteSize) + (KAC10_READER_SOA_ALIGNMENT - 1)))))
+    {
+        return 0;
+    }
+
+    for (c = 0; c < numComponents; c++)
+    {
+        const uintptr_t base = (((uintptr_t)vectors->memory + (KAC10_READER_SOA_ALIGNMENT - 1)) &
+                                ~(uintptr_t)(KAC10_READER_SOA_ALIGNMENT - 1));
+
+        components[c] = (float*)(base + (c * arrayByteSize));
+
+        memset((components[c] + numElements), 0, (arrayByteSize - (numElements * sizeof(float))));
+    }
+
+    input_seek(reader, reader->segmentByteOffsets[segmentId], SEEK_SET);
+    input_read(reader, (char*)&numVectors, sizeof(numVectors));
+
+    if ((numVectors != numElements) ||
+        !kac10_reader__input_stream_is_valid_r(reader))
+    {
+        kac10_reader__free_soa_vectors(vectors);
+        return 0;
+    }
+
+    for (i = 0; i < numVectors; i += 1024)
+    {
+        const uint32_t batchSize = (((numVectors - i) < 1024)? (numVectors - i) : 1024);
+        const size_t batchByteSize = (batchSize * numComponents * sizeof(float));
+        float *batchDst[3];
+
+        batchDst[0] = (components[0] + i);
+        batchDst[1] = (components[1] + i);
+        batchDst[2] = ((numComponents > 2)? (components[2] + i) : NULL);
+
+        if (input_read(reader, batch, batchByteSize) != batchByteSize)
+        {
+            kac10_reader__free_soa_vectors(vectors);
+            return 0;
+        }
+
+        deinterleave_floats(batch, batchDst, numComponents, batchSize);
+    }
+
+    vectors->numVectors = numVectors;
+    vectors->x = components[0];
+    vectors->y = components[1];
+    vectors->z = components[2];
+
+    return numVectors;
+}
+
+uint32_t kac10_reader__read_normals_soa_r(kac10_reader_t *const reader, struct kac10_soa_vectors_s *const normals)
+{
+    return read_segment_data_soa(reader, KAC_1_0_SEGMENT_ID_NORM, 3, normals);
+}
+
+uint32_t kac10_reader__read_uv_coordinates_soa_r(kac10_reader_t *const reader, struct kac10_soa_vectors_s *const uvCoords)
+{
+    return read_segment_data_soa(reader, KAC_1_0_SEGMENT_ID_UV, 2, uvCoords);
+}
+
+uint32_t kac10_reader__read_vertex_coordinates_soa_r(kac10_reader_t *const reader, struct kac10_soa_vectors_s *const vertexCoords)
+{
+    return read_segment_data_soa(reader, KAC_1_0_SEGMENT_ID_VERT, 3, vertexCoords);
+}
+
+void kac10_reader__free_soa_vectors(struct kac10_soa_vectors_s *const vectors)
+{
+    if (vectors->memory)
+    {
+        ALLOCATOR_FREE(vectors->allocator, vectors->memory);
+    }
+
+    memset(vectors, 0, sizeof(*vectors));
+
+    return;
+}
+
+/* Converts the given number of floats, the interleaved components of vectors of
+ * 'numComponents' (2 or 3) elements, into the given fixed-point format. Each
+ * value v of component c becomes (v * multiplier[c]) + addend[c], where the
+ * multipliers and addends are the conversion's scales and biases premultiplied
+ * by the format's fractional scale; saturated to the format's range and
+ * rounded to nearest, halves away from zero.*/
+static void convert_floats_to_fixed_point_scalar(const float *const src,
+                                                 void *const dst,
+                                                 const enum kac10_fixed_point_format_e format,
+                                                 const float *const multiplier,
+                                                 const float *const addend,
+                                                 const unsigned numComponents,
+                                                 const size_t numValues)
+{
+    const float minValue = ((format == KAC10_FIXED_POINT_8_8)? -32768.0f : -2147483648.0f);
+    const float maxValue = ((format == KAC10_FIXED_POINT_8_8)? 32767.0f : 2147483520.0f);
+    size_t i = 0;
+
+    for (i = 0; i < numValues; i++)
+    {
+        float value = ((src[i] * multiplier[i % numComponents]) + addend[i % numComponents]);
+        int32_t fixed = 0;
+        float fraction = 0;
+
+        /* Written so that NaN becomes the minimum, as with the SIMD version.*/
+        value = ((value > minValue)? value : minValue);
+        value = ((value < maxValue)? value : maxValue);
+
+        /* Rounded via the truncated value and the (exactly representable)
+         * fraction left over, since adding 0.5 to the value would itself round
+         * once the value is too large for the float to hold the half.*/
+        fixed = (int32_t)value;
+        fraction = (value - (float)fixed);
+        fixed += ((fraction >= 0.5f) - (fraction <= -0.5f));
+
+        if (format == KAC10_FIXED_POINT_8_8)
+        {
+            ((int16_t*)dst)[i] = (int16_t)fixed;
+        }
+        else
+        {
+            ((int32_t*)dst)[i] = fixed;
+        }
+    }
+
+    return;
+}
+
+#ifdef KAC10_READER_HAS_X86_SIMD
+    /* An SSE2 version of convert_floats_to_fixed_point_scalar(). The components'
+     * multipliers and addends repeat every 12 values for both 2 and 3 components,
+     * so 12 values are converted at a time.*/
+    __attribute__((target("sse2")))
+    static void convert_floats_to_fixed_point_sse2(const float *const src,
+                                                   void *const dst,
+                                                   const enum kac10_fixed_point_format_e format,
+                                                   const float *const multiplier,
+                                                   const float *const addend,
+                                                   const unsigned numComponents,
+                                                   const size_t numValues)
+    {
+        const __m128 minValue = _mm_set1_ps((format == KAC10_FIXED_POINT_8_8)? -32768.0f : -2147483648.0f);
+        const __m128 maxValue = _mm_set1_ps((format == KAC10_FIXED_POINT_8_8)? 32767.0f : 2147483520.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 negativeHalf = _mm_set1_ps(-0.5f);
+        __m128 multipliers[3];
+        __m128 addends[3];
+        size_t i = 0;
+        unsigned k = 0;
+
+        for (k = 0; k < 3; k++)
+        {
+            multipliers[k] = _mm_setr_ps(multiplier[((k * 4) + 0) % numComponents],
+                                         multiplier[((k * 4) + 1) % numComponents],
+                                         multiplier[((k * 4) + 2) % numComponents],
+                                         multiplier[((k * 4) + 3) % numComponents]);
+
+            addends[k] = _mm_setr_ps(addend[((k * 4) + 0) % numComponents],
+                                     addend[((k * 4) + 1) % numComponents],
+                                     addend[((k * 4) + 2) % numComponents],
+                                     addend[((k * 4) + 3) % numComponents]);
+        }
+
+        for (i = 0; (i + 12) <= numValues; i += 12)
+        {
+            for (k = 0; k < 3; k++)
+            {
+                __m128 value = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i + (k * 4)), multipliers[k]), addends[k]);
+                __m128 fraction;
+                __m128i fixed;
+
+                /* _mm_max_ps() returns its second operand if either is NaN.*/
+                value = _mm_min_ps(_mm_max_ps(value, minValue), maxValue);
+                fixed = _mm_cvttps_epi32(value);
+                fraction = _mm_sub_ps(value, _mm_cvtepi32_ps(fixed));
+
+                /* The comparisons' all-ones masks are -1 as integers.*/
+                fixed = _mm_sub_epi32(fixed, _mm_castps_si128(_mm_cmpge_ps(fraction, half)));
+                fixed = _mm_add_epi32(fixed, _mm_castps_si128(_mm_cmple_ps(fraction, negativeHalf)));
+
+                if (format == KAC10_FIXED_POINT_8_8)
+                {
+                    _mm_storel_epi64((__m128i*)((int16_t*)dst + i + (k * 4)), _mm_packs_epi32(fixed, fixed));
+                }
+                else
+                {
+                    _mm_storeu_si128((__m128i*)((int32_t*)dst + i + (k * 4)), fixed);
+                }
+            }
+        }
+
+        convert_floats_to_fixed_point_scalar((src + i),
+                                             ((format == KAC10_FIXED_POINT_8_8)? (void*)((int16_t*)dst + i) : (void*)((int32_t*)dst + i)),
+                                             format,
+                                             multiplier,
+                                             addend,
+                                             numComponents,
+                                             (numValues - i));
+
+        return;
+    }
+#endif
+
+static void convert_floats_to_fixed_point(const float *const src,
+                                          void *const dst,
+                                          const enum kac10_fixed_point_format_e format,
+                                          const float *const multiplier,
+                                          const float *const addend,
+                                          const unsigned numComponents,
+                                          const size_t numValues)
+{
+    #ifdef KAC10_READER_HAS_X86_SIMD
+        if (__builtin_cpu_supports("sse2"))
+        {
+            convert_floats_to_fixed_point_sse2(src, dst, format, multiplier, addend, numComponents, numValues);
+            return;
+        }
+    #endif
+
+    convert_floats_to_fixed_point_scalar(src, dst, format, multiplier, addend, numComponents, numValues);
+
+    return;
+}
+
+/* Reads the given segment, whose elements are vectors of 'numComponents' (2 or
+ * 3) floats, into the given memory of 'dstByteSize' bytes, converting the
+ * floats into fixed-point as described for struct
+ * kac10_fixed_point_conversion_s. Returns the number of vectors read; or 0 if
+ * the segment doesn't exist, is empty, doesn't fit into the memory, or there
+ * was a read error.*/
+static uint32_t read_segment_data_fixed_point(kac10_reader_t *const reader,
+                                              const unsigned segmentId,
+                                              const unsigned numComponents,
+                                              const struct kac10_fixed_point_conversion_s *const conversion,
+                                              void *const dst,
+                                              const size_t dstByteSize)
+{
+    /* The vectors are read in in batches, each of which is then converted.*/
+    float batch[3 * 1024];
+    const size_t valueByteSize = ((conversion->format == KAC10_FIXED_POINT_8_8)? sizeof(int16_t) : sizeof(int32_t));
+    const float fractionScale = ((conversion->format == KAC10_FIXED_POINT_8_8)? 256.0f : 65536.0f);
+    float multiplier[3];
+    float addend[3];
+    uint32_t i = 0, numVectors = 0;
+    unsigned c = 0;
+
+    if (!kac10_reader__input_stream_is_valid_r(reader) ||
+        !(reader->segmentsInFile & (1 << segmentId)))
+    {
+        return 0;
+    }
+
+    for (c = 0; c < numComponents; c++)
+    {
+        multiplier[c] = (conversion->scale[c] * fractionScale);
+        addend[c] = (conversion->bias[c] * fractionScale);
+    }
+
+    input_seek(reader, reader->segmentByteOffsets[segmentId], SEEK_SET);
+    input_read(reader, (char*)&numVectors, sizeof(numVectors));
+
+    if (!numVectors ||
+        !kac10_reader__input_stream_is_valid_r(reader) ||
+        (numVectors > (dstByteSize / (numComponents * valueByteSize))))
+    {
+        return 0;
+    }
+
+    for (i = 0; i < numVectors; i += 1024)
+    {
+        const uint32_t batchSize = (((numVectors - i) < 1024)? (numVectors - i) : 1024);
+        const size_t batchByteSize = (batchSize * numComponents * sizeof(float));
+
+        if (input_read(reader, batch, batchByteSize) != batchByteSize)
+        {
+            return 0;
+        }
+
+        convert_floats_to_fixed_point(batch,
+                                      ((uint8_t*)dst + (i * numComponents * valueByteSize)),
+                                      conversion->format,
+                                      multiplier,
+                                      addend,
+                                      numComponents,
+                                      (batchSize * numComponents));
+    }
+
+    return numVectors;
+}
+
+uint32_t kac10_reader__read_normals_fixed_into_r(kac10_reader_t *const reader,
+                                                  const struct kac10_fixed_point_conversion_s *const conversion,
+                                                  void *const normals,
+                                                  const size_t dstByteSize)
+{
+    return read_segment_data_fixed_point(reader, KAC_1_0_SEGMENT_ID_NORM, 3, conversion, normals, dstByteSize);
+}
+
+uint32_t kac10_reader__read_uv_coordinates_fixed_into_r(kac10_reader_t *const reader,
+                                                         const struct kac10_fixed_point_conversion_s *const conversion,
+                                                         void *const uvCoords,
+                                                         const size_t dstByteSize)
+{
+    return read_segment_data_fixed_point(reader, KAC_1_0_SEGMENT_ID_UV, 2, conversion, uvCoords, dstByteSize);
+}
+
+uint32_t kac10_reader__read_vertex_coordinates_fixed_into_r(kac10_reader_t *const reader,
+                                                             const struct kac10_fixed_point_conversion_s *const conversion,
+                                                             void *const vertexCoords,
+                                                             const size_t dstByteSize)
+{
+    return read_segment_data_fixed_point(reader, KAC_1_0_SEGMENT_ID_VERT, 3, conversion, vertexCoords, dstByteSize);
+}
+
+/* Returns the number of elements in the given segment of the file opened with
+ * kac10_reader__open_file_mapped_r(), and points 'data' to the first of them in
+ * the mapped file. If the segment doesn't exist, is truncated, or its data
+ * aren't aligned to 'elementAlignment' bytes in memory, returns 0 and sets
+ * 'data' to NULL.*/
+static uint32_t map_segment_data(const kac10_reader_t *const reader,
+                                 const unsigned segmentId,
+                                 const size_t elementByteSize,
+                                 const size_t elementAlignment,
+                                 const void **data)
+{
+    const size_t countOffset = reader->segmentByteOffsets[segmentId];
+    const size_t dataOffset = (countOffset + sizeof(uint32_t));
+    uint32_t numElements = 0;
+
+    *data = NULL;
+
+    if (!reader->data ||
+        !kac10_reader__input_stream_is_valid_r(reader) ||
+        !(reader->segmentsInFile & (1 << segmentId)) ||
+        (dataOffset > reader->dataSize))
+    {
+        return 0;
+    }
+
+    memcpy((char*)&numElements, (reader->data + countOffset), sizeof(numElements));
+
+    if ((numElements > ((reader->dataSize - dataOffset) / elementByteSize)) ||
+        ((uintptr_t)(reader->data + dataOffset) % elementAlignment))
+    {
+        return 0;
+    }
+
+    *data = (reader->data + dataOffset);
+
+    return numElements;
+}
+
+uint32_t kac10_reader__map_normals_r(const kac10_reader_t *const reader, const struct kac_1_0_normal_s **normals)
+{
+    const void *data = NULL;
+    const uint32_t numNormals = map_segment_data(reader, KAC_1_0_SEGMENT_ID_NORM, 12, sizeof(float), &data);
+
+    assert((sizeof(**normals) == 12) && "Unexpected padding in the normal struct.");
+
+    *normals = data;
+
+    return numNormals;
+}
+
+uint32_t kac10_reader__map_uv_coordinates_r(const kac10_reader_t *const reader, const struct kac_1_0_uv_coordinates_s **uvCoords)
+{
+    const void *data = NULL;
+    const uint32_t numUVCoords = map_segment_data(reader, KAC_1_0_SEGMENT_ID_UV, 8, sizeof(float), &data);
+
+    assert((sizeof(**uvCoords) == 8) && "Unexpected padding in the UV coordinates struct.");
+
+    *uvCoords = data;
+
+    return numUVCoords;
+}
+
+uint32_t kac10_reader__map_vertex_coordinates_r(const kac10_reader_t *const reader, const struct kac_1_0_vertex_coordinates_s **vertexCoords)
+{
+    const void *data = NULL;
+    const uint32_t numVertexCoords = map_segment_data(reader, KAC_1_0_SEGMENT_ID_VERT, 12, sizeof(float), &data);
+
+    assert((sizeof(**vertexCoords) == 12) && "Unexpected padding in the vertex coordinates struct.");
+
+    *vertexCoords = data;
+
+    return numVertexCoords;
+}
+
+uint32_t kac10_reader__map_triangles_r(const kac10_reader_t *const reader, const struct kac_1_0_triangle_s **triangles)
+{
+    const void *data = NULL;
+    const uint32_t numTriangles = map_segment_data(reader, KAC_1_0_SEGMENT_ID_3MSH, 20, sizeof(uint16_t), &data);
+
+    assert((sizeof(**triangles) == 20) && "Unexpected padding in the triangle struct.");
+
+    *triangles = data;
+
+    return numTriangles;
+}
+
+/* Returns the given segment's data from the reader's cache, decoding the
+ * segment into the cache first if it hasn't been yet. As with map_segment_data(),
+ * the segment's elements must be stored in the file as in memory.*/
+static uint32_t get_cached_segment_data(kac10_reader_t *const reader,
+                                        const unsigned segmentId,
+                                        const size_t elementByteSize,
+                                        const size_t elementAlignment,
+                                        const void **data)
+{
+    struct segment_cache_s *const cache = &reader->segmentCache[segmentId];
+
+    if (!cache->isCached &&
+        reader->segmentElementCounts[segmentId])
+    {
+        const void *mappedData = NULL;
+        void *decodedData = NULL;
+        const size_t byteSize = (reader->segmentElementCounts[segmentId] * elementByteSize);
+
+        /* Data in memory are used in place if possible.*/
+        if ((cache->numElements = map_segment_data(reader, segmentId, elementByteSize, elementAlignment, &mappedData)))
+        {
+            cache->data = mappedData;
+            cache->isCached = 1;
+        }
+        else if ((decodedData = ALLOCATOR_MALLOC(reader->ownAllocator, byteSize)))
+        {
+            if ((cache->numElements = read_segment_data_into(reader, segmentId, elementByteSize, decodedData, byteSize)))
+            {
+                cache->data = decodedData;
+                cache->isCached = 1;
+                cache->isOwned = 1;
+            }
+            else
+            {
+                ALLOCATOR_FREE(reader->ownAllocator, decodedData);
+            }
+        }
+    }
+
+    *data = cache->data;
+
+    return cache->numElements;
+}
+
+uint32_t kac10_reader__get_normals_r(kac10_reader_t *const reader, const struct kac_1_0_normal_s **normals)
+{
+    const void *data = NULL;
+    const uint32_t numNormals = get_cached_segment_data(reader, KAC_1_0_SEGMENT_ID_NORM, 12, sizeof(float), &data);
+
+    *normals = data;
+
+    return numNormals;
+}
+
+uint32_t kac10_reader__get_triangles_r(kac10_reader_t *const reader, const struct kac_1_0_triangle_s **triangles)
+{
+    const void *data = NULL;
+    const uint32_t numTriangles = get_cached_segment_data(reader, KAC_1_0_SEGMENT_ID_3MSH, 20, sizeof(uint16_t), &data);
+
+    *triangles = data;
+
+    return numTriangles;
+}
+
+uint32_t kac10_reader__get_uv_coordinates_r(kac10_reader_t *const reader, const struct kac_1_0_uv_coordinates_s **uvCoords)
+{
+    const void *data = NULL;
+    const uint32_t numUVs = get_cached_segment_data(reader, KAC_1_0_SEGMENT_ID_UV, 8, sizeof(float), &data);
+
+    *uvCoords = data;
+
+    return numUVs;
+}
+
+uint32_t kac10_reader__get_vertex_coordinates_r(kac10_reader_t *const reader, const struct kac_1_0_vertex_coordinates_s **vertexCoords)
+{
+    const void *data = NULL;
+    const uint32_t numVertices = get_cached_segment_data(reader, KAC_1_0_SEGMENT_ID_VERT, 12, sizeof(float), &data);
+
+    *vertexCoords = data;
+
+    return numVertices;
+}
+
+uint32_t kac10_reader__get_materials_r(kac10_reader_t *const reader, const struct kac_1_0_material_s **materials)
+{
+    struct segment_cache_s *const cache = &reader->segmentCache[KAC_1_0_SEGMENT_ID_MATE];
+
+    /* Materials are stored in a packed form in the file, so always need decoding.*/
+    if (!cache->isCached &&
+        reader->segmentElementCounts[KAC_1_0_SEGMENT_ID_MATE])
+    {
+        const size_t byteSize = (reader->segmentElementCounts[KAC_1_0_SEGMENT_ID_MATE] * sizeof(struct kac_1_0_material_s));
+        struct kac_1_0_material_s *const decodedData = ALLOCATOR_MALLOC(reader->ownAllocator, byteSize);
+
+        if (decodedData)
+        {
+            if ((cache->numElements = kac10_reader__read_materials_into_r(reader, decodedData, byteSize)))
+            {
+                cache->data = decodedData;
+                cache->isCached = 1;
+                cache->isOwned = 1;
+            }
+            else
+            {
+                ALLOCATOR_FREE(reader->ownAllocator, decodedData);
+            }
+        }
+    }
+
+    *materials = cache->data;
+
+    return cache->numElements;
+}
+
+uint32_t kac10_reader__get_textures_r(kac10_reader_t *const reader, const struct kac10_texture_set_s **textures)
+{
+    struct segment_cache_s *const cache = &reader->segmentCache[KAC_1_0_SEGMENT_ID_TXTR];
+
+    if (!cache->isCached &&
+        kac10_reader__file_has_textures_r(reader) &&
+        kac10_reader__read_texture_set_r(reader, &reader->textureCache))
+    {
+        cache->data = &reader->textureCache;
+        cache->numElements = reader->textureCache.numTextures;
+        cache->isCached = 1;
+    }
+
+    *textures = cache->data;
+
+    return cache->numElements;
+}
+
+int kac10_reader__file_has_textures_r(const kac10_reader_t *const reader)
+{
+    return (reader->segmentsInFile & (1 << KAC_1_0_SEGMENT_ID_TXTR));
+}
+
+int kac10_reader__file_has_normals_r(const kac10_reader_t *const reader)
+{
+    return (reader->segmentsInFile & (1 << KAC_1_0_SEGMENT_ID_NORM));
+}
+
+int kac10_reader__file_has_materials_r(const kac10_reader_t *const reader)
+{
+    return (reader->segmentsInFile & (1 << KAC_1_0_SEGMENT_ID_MATE));
+}
+
+int kac10_reader__file_has_triangles_r(const kac10_reader_t *const reader)
+{
+    return (reader->segmentsInFile & (1 << KAC_1_0_SEGMENT_ID_3MSH));
+}
+
+int kac10_reader__file_has_uv_coordinates_r(const kac10_reader_t *const reader)
+{
+    return (reader->segmentsInFile & (1 << KAC_1_0_SEGMENT_ID_UV));
+}
+
+int kac10_reader__file_has_vertex_coordinates_r(const kac10_reader_t *const reader)
+{
+    return (reader->segmentsInFile & (1 << KAC_1_0_SEGMENT_ID_VERT));
+}
+
+void kac10_reader__set_allocator(const struct kac10_allocator_s *const allocator)
+{
+    if (allocator)
+    {
+        assert(allocator->mallocFn && allocator->callocFn && allocator->freeFn &&
+               "All allocator callbacks must be provided.");
+
+        GLOBAL_ALLOCATOR = *allocator;
+    }
+    else
+    {
+        const struct kac10_allocator_s defaultAllocator = {default_malloc, default_calloc, default_free, NULL};
+
+        GLOBAL_ALLOCATOR = defaultAllocator;
+    }
+
+    return;
+}
+
+void kac10_reader__set_texture_layout_r(kac10_reader_t *const reader, const enum kac10_texture_layout_e layout)
+{
+    reader->textureLayout = layout;
+
+    return;
+}
+
+void kac10_reader__set_allocator_r(kac10_reader_t *const reader, const struct kac10_allocator_s *const allocator)
+{
+    if (allocator)
+    {
+        assert(allocator->mallocFn && allocator->callocFn && allocator->freeFn &&
+               "All allocator callbacks must be provided.");
+
+        reader->allocator = *allocator;
+    }
+    else
+    {
+        reader->allocator = GLOBAL_ALLOCATOR;
+    }
+
+    return;
+}
+
+/* The functions below operate on the global reader, for callers that only need
+ * to read one file at a time.*/
+
+void kac10_reader__set_texture_layout(const enum kac10_texture_layout_e layout)
+{
+    if (GLOBAL_READER)
+    {
+        kac10_reader__set_texture_layout_r(GLOBAL_READER, layout);
+    }
+
+    return;
+}
+
+int kac10_reader__open_file(const char *const filename)
+{
+    assert(!GLOBAL_READER && "Attempting to open a new KAC file before closing the previous one.");
+
+    GLOBAL_READER = kac10_reader__open_file_r(filename);
+
+    return (GLOBAL_READER != NULL);
+}
+
+int kac10_reader__open_file_mapped(const char *const filename)
+{
+    assert(!GLOBAL_READER && "Attempting to open a new KAC file before closing the previous one.");
+
+    GLOBAL_READER = kac10_reader__open_file_mapped_r(filename);
+
+    return (GLOBAL_READER != NULL);
+}
+
+int kac10_reader__open_memory(const void *const data, const size_t byteSize)
+{
+    assert(!GLOBAL_READER && "Attempting to open a new KAC file before closing the previous one.");
+
+    GLOBAL_READER = kac10_reader__open_memory_r(data, byteSize);
+
+    return (GLOBAL_READER != NULL);
+}
+
+int kac10_reader__close_file(void)
+{
+    const int success = kac10_reader__close_file_r(GLOBAL_READER);
+
+    GLOBAL_READER = NULL;
+
+    return success;
+}
+
+int kac10_reader__input_stream_is_valid(void)
+{
+    return (GLOBAL_READER && kac10_reader__input_stream_is_valid_r(GLOBAL_READER));
+}
+
+uint32_t kac10_reader__read_normals(struct kac_1_0_normal_s **normals)
+{
+    return (GLOBAL_READER? kac10_reader__read_normals_r(GLOBAL_READER, normals) : 0);
+}
+
+uint32_t kac10_reader__read_textures(struct kac_1_0_texture_s **textures)
+{
+    return (GLOBAL_READER? kac10_reader__read_textures_r(GLOBAL_READER, textures) : 0);
+}
+
+uint32_t kac10_reader__read_packed_textures(struct kac_1_0_packed_texture_s **textures)
+{
+    return (GLOBAL_READER? kac10_reader__read_packed_textures_r(GLOBAL_READER, textures) : 0);
+}
+
+uint32_t kac10_reader__read_texture_set(struct kac10_texture_set_s *const textureSet)
+{
+    if (!GLOBAL_READER)
+    {
+        memset(textureSet, 0, sizeof(*textureSet));
+        return 0;
+    }
+
+    return kac10_reader__read_texture_set_r(GLOBAL_READER, textureSet);
+}
+
+int kac10_reader__query_sizes(struct kac10_segment_sizes_s *const sizes)
+{
+    if (!GLOBAL_READER)
+    {
+        memset(sizes, 0, sizeof(*sizes));
+        return 0;
+    }
+
+    return kac10_reader__query_sizes_r(GLOBAL_READER, sizes);
+}
+
+int kac10_reader__query_texture_size(const uint32_t textureIdx, struct kac10_texture_size_s *const size)
+{
+    if (!GLOBAL_READER)
+    {
+        memset(size, 0, sizeof(*size));
+        return 0;
+    }
+
+    return kac10_reader__query_texture_size_r(GLOBAL_READER, textureIdx, size);
+}
+
+uint32_t kac10_reader__read_texture_into(const uint32_t textureIdx,
+                                         struct kac_1_0_texture_metadata_s *const metadata,
+                                         kac_1_0_packed_texture_pixel_t *const pixels,
+                                         const size_t dstByteSize)
+{
+    return (GLOBAL_READER? kac10_reader__read_texture_into_r(GLOBAL_READER, textureIdx, metadata, pixels, dstByteSize) : 0);
+}
+
+uint32_t kac10_reader__read_converted_texture_into(const uint32_t textureIdx,
+                                                   const enum kac10_pixel_format_e format,
+                                                   struct kac_1_0_texture_metadata_s *const metadata,
+                                                   void *const pixels,
+                                                   const size_t dstByteSize)
+{
+    return (GLOBAL_READER? kac10_reader__read_converted_texture_into_r(GLOBAL_READER, textureIdx, format, metadata, pixels, dstByteSize) : 0);
+}
+
+uint32_t kac10_reader__read_texture(const uint32_t textureIdx,
+                                    const uint32_t firstMipLevel,
+                                    const uint32_t lastMipLevel,
+                                    struct kac_1_0_texture_s *const texture)
+{
+    memset(texture, 0, sizeof(*texture));
+
+    return (GLOBAL_READER? kac10_reader__read_texture_r(GLOBAL_READER, textureIdx, firstMipLevel, lastMipLevel, texture) : 0);
+}
+
+uint32_t kac10_reader__read_packed_texture(const uint32_t textureIdx,
+                                           const uint32_t firstMipLevel,
+                                           const uint32_t lastMipLevel,
+                                           struct kac_1_0_packed_texture_s *const texture)
+{
+    memset(texture, 0, sizeof(*texture));
+
+    return (GLOBAL_READER? kac10_reader__read_packed_texture_r(GLOBAL_READER, textureIdx, firstMipLevel, lastMipLevel, texture) : 0);
+}
+
+uint32_t kac10_reader__read_materials(struct kac_1_0_material_s **materials)
+{
+    return (GLOBAL_READER? kac10_reader__read_materials_r(GLOBAL_READER, materials) : 0);
+}
+
+uint32_t kac10_reader__read_triangles(struct kac_1_0_triangle_s **triangles)
+{
+    return (GLOBAL_READER? kac10_reader__read_triangles_r(GLOBAL_READER, triangles) : 0);
+}
+
+uint32_t kac10_reader__read_uv_coordinates(struct kac_1_0_uv_coordinates_s **uvCoords)
+{
+    return (GLOBAL_READER? kac10_reader__read_uv_coordinates_r(GLOBAL_READER, uvCoords) : 0);
+}
+
+uint32_t kac10_reader__read_vertex_coordinates(struct kac_1_0_vertex_coordinates_s **vertexCoords)
+{
+    return (GLOBAL_READER? kac10_reader__read_vertex_coordinates_r(GLOBAL_READER, vertexCoords) : 0);
+}
+
+uint32_t kac10_reader__read_normals_soa(struct kac10_soa_vectors_s *const normals)
+{
+    if (!GLOBAL_READER)
+    {
+        memset(normals, 0, sizeof(*normals));
+        return 0;
+    }
+
+    return kac10_reader__read_normals_soa_r(GLOBAL_READER, normals);
+}
+
+uint32_t kac10_reader__read_uv_coordinates_soa(struct kac10_soa_vectors_s *const uvCoords)
+{
+    if (!GLOBAL_READER)
+    {
+        memset(uvCoords, 0, sizeof(*uvCoords));
+        return 0;
+    }
+
+    return kac10_reader__read_uv_coordinates_soa_r(GLOBAL_READER, uvCoords);
+}
+
+uint32_t kac10_reader__read_vertex_coordinates_soa(struct kac10_soa_vectors_s *const vertexCoords)
+{
+    if (!GLOBAL_READER)
+    {
+        memset(vertexCoords, 0, sizeof(*vertexCoords));
+        return 0;
+    }
+
+    return kac10_reader__read_vertex_coordinates_soa_r(GLOBAL_READER, vertexCoords);
+}
+
+uint32_t kac10_reader__read_normals_into(struct kac_1_0_normal_s *const normals, const size_t dstByteSize)
+{
+    return (GLOBAL_READER? kac10_reader__read_normals_into_r(GLOBAL_READER, normals, dstByteSize) : 0);
+}
+
+uint32_t kac10_reader__read_materials_into(struct kac_1_0_material_s *const materials, const size_t dstByteSize)
+{
+    return (GLOBAL_READER? kac10_reader__read_materials_into_r(GLOBAL_READER, materials, dstByteSize) : 0);
+}
+
+uint32_t kac10_reader__read_triangles_into(struct kac_1_0_triangle_s *const triangles, const size_t dstByteSize)
+{
+    return (GLOBAL_READER? kac10_reader__read_triangles_into_r(GLOBAL_READER, triangles, dstByteSize) : 0);
+}
+
+uint32_t kac10_reader__read_uv_coordinates_into(struct kac_1_0_uv_coordinates_s *const uvCoords, const size_t dstByteSize)
+{
+    return (GLOBAL_READER? kac10_reader__read_uv_coordinates_into_r(GLOBAL_READER, uvCoords, dstByteSize) : 0);
+}
+
+uint32_t kac10_reader__read_vertex_coordinates_into(struct kac_1_0_vertex_coordinates_s *const vertexCoords, const size_t dstByteSize)
+{
+    return (GLOBAL_READER? kac10_reader__read_vertex_coordinates_into_r(GLOBAL_READER, vertexCoords, dstByteSize) : 0);
+}
+
+uint32_t kac10_reader__read_normals_fixed_into(const struct kac10_fixed_point_conversion_s *const conversion,
+                                               void *const normals,
+                                               const size_t dstByteSize)
+{
+    return (GLOBAL_READER? kac10_reader__read_normals_fixed_into_r(GLOBAL_READER, conversion, normals, dstByteSize) : 0);
+}
+
+uint32_t kac10_reader__read_uv_coordinates_fixed_into(const struct kac10_fixed_point_conversion_s *const conversion,
+                                                      void *const uvCoords,
+                                                      const size_t dstByteSize)
+{
+    return (GLOBAL_READER? kac10_reader__read_uv_coordinates_fixed_into_r(GLOBAL_READER, conversion, uvCoords, dstByteSize) : 0);
+}
+
+uint32_t kac10_reader__read_vertex_coordinates_fixed_into(const struct kac10_fixed_point_conversion_s *const conversion,
+                                                          void *const vertexCoords,
+                                                          const size_t dstByteSize)
+{
+    return (GLOBAL_READER? kac10_reader__read_vertex_coordinates_fixed_into_r(GLOBAL_READER, conversion, vertexCoords, dstByteSize) : 0);
+}
+
+uint32_t kac10_reader__map_normals(const struct kac_1_0_normal_s **normals)
+{
+    *normals = NULL;
+
+    return (GLOBAL_READER? kac10_reader__map_normals_r(GLOBAL_READER, normals) : 0);
+}
+
+uint32_t kac10_reader__map_triangles(const struct kac_1_0_triangle_s **triangles)
+{
+    *triangles = NULL;
+
+    return (GLOBAL_READER? kac10_reader__map_triangles_r(GLOBAL_READER, triangles) : 0);
+}
+
+uint32_t kac10_reader__map_uv_coordinates(const struct kac_1_0_uv_coordinates_s **uvCoords)
+{
+    *uvCoords = NULL;
+
+    return (GLOBAL_READER? kac10_reader__map_uv_coordinates_r(GLOBAL_READER, uvCoords) : 0);
+}
+
+uint32_t kac10_reader__map_vertex_coordinates(const struct kac_1_0_vertex_coordinates_s **vertexCoords)
+{
+    *vertexCoords = NULL;
+
+    return (GLOBAL_READER? kac10_reader__map_vertex_coordinates_r(GLOBAL_READER, vertexCoords) : 0);
+}
+
+uint32_t kac10_reader__get_normals(const struct kac_1_0_normal_s **normals)
+{
+    *normals = NULL;
+
+    return (GLOBAL_READER? kac10_reader__get_normals_r(GLOBAL_READER, normals) : 0);
+}
+
+uint32_t kac10_reader__get_textures(const struct kac10_texture_set_s **textures)
+{
+    *textures = NULL;
+
+    return (GLOBAL_READER? kac10_reader__get_textures_r(GLOBAL_READER, textures) : 0);
+}
+
+uint32_t kac10_reader__get_materials(const struct kac_1_0_material_s **materials)
+{
+    *materials = NULL;
+
+    return (GLOBAL_READER? kac10_reader__get_materials_r(GLOBAL_READER, materials) : 0);
+}
+
+uint32_t kac10_reader__get_triangles(const struct kac_1_0_triangle_s **triangles)
+{
+    *triangles = NULL;
+
+    return (GLOBAL_READER? kac10_reader__get_triangles_r(GLOBAL_READER, triangles) : 0);
+}
+
+uint32_t kac10_reader__get_uv_coordinates(const struct kac_1_0_uv_coordinates_s **uvCoords)
+{
+    *uvCoords = NULL;
+
+    return (GLOBAL_READER? kac10_reader__get_uv_coordinates_r(GLOBAL_READER, uvCoords) : 0);
+}
+
+uint32_t kac10_reader__get_vertex_coordinates(const struct kac_1_0_vertex_coordinates_s **vertexCoords)
+{
+    *vertexCoords = NULL;
+
+    return (GLOBAL_READER? kac10_reader__get_vertex_coordinates_r(GLOBAL_READER, vertexCoords) : 0);
+}
+
+int kac10_reader__file_has_normals(void)
+{
+    return (GLOBAL_READER && kac10_reader__file_has_normals_r(GLOBAL_READER));
+}
+
+int kac10_reader__file_has_textures(void)
 {
-    return (SEGMENTS_IN_FILE & (1 << KAC_1_0_SEGMENT_ID_NORM));
+    return (GLOBAL_READER && kac10_reader__file_has_textures_r(GLOBAL_READER));
 }
 
 int kac10_reader__file_has_materials(void)
 {
-    return (SEGMENTS_IN_FILE & (1 << KAC_1_0_SEGMENT_ID_MATE));
+    return (GLOBAL_READER && kac10_reader__file_has_materials_r(GLOBAL_READER));
 }
 
 int kac10_reader__file_has_triangles(void)
 {
-    return (SEGMENTS_IN_FILE & (1 << KAC_1_0_SEGMENT_ID_3MSH));
+    return (GLOBAL_READER && kac10_reader__file_has_triangles_r(GLOBAL_READER));
 }
 
 int kac10_reader__file_has_uv_coordinates(void)
 {
-    return (SEGMENTS_IN_FILE & (1 << KAC_1_0_SEGMENT_ID_UV));
+    return (GLOBAL_READER && kac10_reader__file_has_uv_coordinates_r(GLOBAL_READER));
 }
 
 int kac10_reader__file_has_vertex_coordinates(void)
 {
-    return (SEGMENTS_IN_FILE & (1 << KAC_1_0_SEGMENT_ID_VERT));
+    return (GLOBAL_READER && kac10_reader__file_has_vertex_coordinates_r(GLOBAL_READER));
 }
@@ -10,16 +10,198 @@
 #ifndef IMPORT_KAC_1_0_H
 #define IMPORT_KAC_1_0_H
 
+#include <stddef.h>
 #include "../kac_1_0_types.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* An open KAC 1.0 file along with the reader's state for it.
+ * 
+ * The functions with an _r suffix take in the reader to operate on, and so
+ * allow any number of files to be open and read at once, e.g. one per thread.
+ * A given reader must not be used from more than one thread at a time. The
+ * functions without the suffix operate on a single global reader, which is
+ * set up by kac10_reader__open_file().*/
+typedef struct kac10_reader_s kac10_reader_t;
+
+/* Memory allocation callbacks for the reader, with the semantics of malloc(),
+ * calloc() and free(). Each callback also receives 'userData'.*/
+struct kac10_allocator_s
+{
+    void* (*mallocFn)(size_t size, void *userData);
+    void* (*callocFn)(size_t count, size_t size, void *userData);
+    void (*freeFn)(void *ptr, void *userData);
+    void *userData;
+};
+
+/* The alignment, in bytes, of the memory blocks in a texture set.*/
+#define KAC10_READER_ARENA_ALIGNMENT 64u
+
+/* A file's textures, with the texture structs and the pixel data of all of
+ * their mip levels held in a single block of memory, 'memory', which is freed
+ * in one go by kac10_reader__free_texture_set(). Each mip level starts on a
+ * KAC10_READER_ARENA_ALIGNMENT-byte boundary.*/
+struct kac10_texture_set_s
+{
+    uint32_t numTextures;
+    struct kac_1_0_packed_texture_s *textures;
+    void *memory;
+    struct kac10_allocator_s allocator; /* That 'memory' was allocated with.*/
+};
+
+/* The number of elements in each of a KAC file's segments, and the number of
+ * bytes they take up when decoded into memory by the kac10_reader__read_xxx()
+ * functions. For textures, the byte size is that of the packed pixels of all
+ * mip levels of all textures (see kac10_reader__query_texture_size() for the
+ * sizes of individual textures).*/
+struct kac10_segment_sizes_s
+{
+    uint32_t numNormals;
+    uint32_t numTextures;
+    uint32_t numMaterials;
+    uint32_t numTriangles;
+    uint32_t numUVCoordinates;
+    uint32_t numVertexCoordinates;
+
+    size_t normalsByteSize;
+    size_t texturesByteSize;
+    size_t materialsByteSize;
+    size_t trianglesByteSize;
+    size_t uvCoordinatesByteSize;
+    size_t vertexCoordinatesByteSize;
+};
+
+/* The size of an individual texture's packed pixel data, as read by
+ * kac10_reader__read_texture_into(). The mip levels are laid out one after
+ * the other, starting from the base level.*/
+struct kac10_texture_size_s
+{
+    uint32_t sideLength;
+    uint32_t numMipLevels;
+    size_t byteSize; /* Of all mip levels.*/
+    size_t mipLevelByteOffset[KAC_1_0_MAX_NUM_MIP_LEVELS];
+    size_t mipLevelByteSize[KAC_1_0_MAX_NUM_MIP_LEVELS];
+};
+
+/* How a texture's pixels are ordered in memory within each of its mip levels,
+ * as set with kac10_reader__set_texture_layout().*/
+enum kac10_texture_layout_e
+{
+    /* Row by row, as stored in the file.*/
+    KAC10_TEXTURE_LAYOUT_LINEAR = 0,
+
+    /* In Morton (Z) order: the pixel at (x, y) is at the index whose even bits
+     * are the bits of x and whose odd bits are the bits of y.*/
+    KAC10_TEXTURE_LAYOUT_MORTON,
+
+    /* In tiles of 4 x 4 pixels, the tiles row by row and each tile's pixels row
+     * by row. Mip levels smaller than 4 x 4 are laid out row by row.*/
+    KAC10_TEXTURE_LAYOUT_TILED_4X4
+};
+
+/* Pixel formats that texture pixels can be converted into as they're read, with
+ * kac10_reader__read_converted_texture_into(). Colors are expanded or truncated
+ * to the format's number of bits per channel. The 16-bit formats are 16-bit
+ * words in native byte order, with the channels listed from the most to the
+ * least significant bits.*/
+enum kac10_pixel_format_e
+{
+    /* The format the pixels are stored in (see kac_1_0_packed_texture_pixel_t),
+     * i.e. no conversion.*/
+    KAC10_PIXEL_FORMAT_KAC_5551 = 0,
+
+    /* 32 bits per pixel: red, green, blue and alpha bytes, in that order in
+     * memory. Alpha is either 0 or 255.*/
+    KAC10_PIXEL_FORMAT_RGBA8888,
+
+    /* Alpha in bit 15, red in bits 10-14, green in bits 5-9, blue in bits 0-4.*/
+    KAC10_PIXEL_FORMAT_ARGB1555,
+
+    /* Red in bits 11-15, green in bits 5-10, blue in bits 0-4, no alpha.*/
+    KAC10_PIXEL_FORMAT_RGB565,
+
+    /* Red in bits 12-15, green in bits 8-11, blue in bits 4-7, alpha in bits
+     * 0-3 (either 0 or 15).*/
+    KAC10_PIXEL_FORMAT_RGBA4444
+};
+
+/* The alignment, in bytes, of the component arrays in struct
+ * kac10_soa_vectors_s.*/
+#define KAC10_READER_SOA_ALIGNMENT 32u
+
+/* Vertex coordinates, normals or UV coordinates with each component in its
+ * own array (structure of arrays), e.g. for processing several elements at a
+ * time with SIMD. For UV coordinates, 'x' holds the u and 'y' the v components,
+ * and 'z' is NULL. Each array starts on a KAC10_READER_SOA_ALIGNMENT-byte
+ * boundary and is padded with zeros to a multiple of that many bytes, so it can
+ * be processed in whole vectors without a scalar tail. The arrays are held in a
+ * single block of memory, 'memory', which is freed by
+ * kac10_reader__free_soa_vectors().*/
+struct kac10_soa_vectors_s
+{
+    uint32_t numVectors;
+    float *x;
+    float *y;
+    float *z;
+    void *memory;
+    struct kac10_allocator_s allocator; /* That 'memory' was allocated with.*/
+};
+
+/* Fixed-point formats that vertex coordinates, normals and UV coordinates can be
+ * converted into as they're read, with the kac10_reader__read_xxx_fixed_into()
+ * functions.*/
+enum kac10_fixed_point_format_e
+{
+    /* int32_t with 16 fractional bits.*/
+    KAC10_FIXED_POINT_16_16 = 0,
+
+    /* int16_t with 8 fractional bits.*/
+    KAC10_FIXED_POINT_8_8
+};
+
+/* How floats are converted into fixed-point: each value v of component c (x, y
+ * and z; or u and v) becomes ((v * scale[c]) + bias[c]) in the given format,
+ * rounded to nearest (halves away from zero) and saturated to the format's
+ * range. For UV coordinates, only the first two scales and biases are used.*/
+struct kac10_fixed_point_conversion_s
+{
+    enum kac10_fixed_point_format_e format;
+    float scale[3];
+    float bias[3];
+};
+
+/* Sets the allocator that readers opened after this call will use for all of
+ * their memory allocations, including the data returned by the read functions,
+ * which should then be freed with the same allocator. Passing NULL restores
+ * the default allocator (malloc(), calloc() and free()). This isn't thread-safe
+ * and should be called before any readers are opened.*/
+void kac10_reader__set_allocator(const struct kac10_allocator_s *const allocator);
+
 /* Sets the target file to be read from. Returns 1 if the target is a valid KAC
  * 1.0 file that is ready to be read from; otherwise, returns 0. This function
  * must be called prior to calling any functions that read data, since they
  * operate on the file set by this function.*/
 int kac10_reader__open_file(const char *const filename);
 
-/* Closes the target file set by kac10_reader__open_file(). Returns 1 if
- * the file was successfully closed; 0 otherwise.*/
+/* Like kac10_reader__open_file(), but maps the whole file into memory (or, on
+ * platforms without mmap(), reads it into memory with a single read). Data can
+ * then be accessed in place with the kac10_reader__map_xxx() functions, though
+ * the kac10_reader__read_xxx() functions also work on a file opened this way.*/
+int kac10_reader__open_file_mapped(const char *const filename);
+
+/* Like kac10_reader__open_file_mapped(), but reads a KAC 1.0 file that's
+ * already in memory, e.g. having been decompressed from a package file, given a
+ * pointer to its first byte and its size in bytes. The data aren't copied, so
+ * they must remain valid and unmodified until kac10_reader__close_file() is
+ * called, and are not released by it. The kac10_reader__map_xxx() functions
+ * point directly into the data.*/
+int kac10_reader__open_memory(const void *const data, const size_t byteSize);
+
+/* Closes the target file set by kac10_reader__open_file(),
+ * kac10_reader__open_file_mapped() or kac10_reader__open_memory(). Returns 1 if the file was successfully
+ * closed; 0 otherwise.*/
 int kac10_reader__close_file(void);
 
 /* Returns 1 if the input file's IO stream is currently valid (the file is open,
@@ -43,6 +225,147 @@ uint32_t kac10_reader__read_triangles(struct kac_1_0_triangle_s **triangles);
 uint32_t kac10_reader__read_uv_coordinates(struct kac_1_0_uv_coordinates_s **uvCoords);
 uint32_t kac10_reader__read_vertex_coordinates(struct kac_1_0_vertex_coordinates_s **vertexCoords);
 
+/* Like kac10_reader__read_textures(), but gives the texture pixels in the packed
+ * 16-bit format in which they're stored in the file, at half the memory cost
+ * of struct kac_1_0_texture_pixel_s and with no unpacking needed.*/
+uint32_t kac10_reader__read_packed_textures(struct kac_1_0_packed_texture_s **textures);
+
+/* Like kac10_reader__read_packed_textures(), but places all of the textures in
+ * a single allocation (see struct kac10_texture_set_s). Returns the number of
+ * textures read. The set must be released with kac10_reader__free_texture_set()
+ * (which is safe to call also on a set that failed to read).*/
+uint32_t kac10_reader__read_texture_set(struct kac10_texture_set_s *const textureSet);
+void kac10_reader__free_texture_set(struct kac10_texture_set_s *const textureSet);
+
+/* Sets the layout in which the texture read functions place the pixels of each
+ * mip level (KAC10_TEXTURE_LAYOUT_LINEAR by default). The pixels are reordered
+ * as they're read in, so no extra pass over the data is needed. Textures
+ * already decoded by kac10_reader__get_textures() keep the layout they were
+ * decoded in.*/
+void kac10_reader__set_texture_layout(const enum kac10_texture_layout_e layout);
+
+/* Report the element counts and decoded byte sizes of the file's segments, or
+ * of the given texture, so that the caller can allocate memory for the data
+ * to be read into with the kac10_reader__read_xxx_into() functions. Return 1
+ * on success; 0 otherwise, including if the file's element counts claim more
+ * data than the file holds.*/
+int kac10_reader__query_sizes(struct kac10_segment_sizes_s *const sizes);
+int kac10_reader__query_texture_size(const uint32_t textureIdx, struct kac10_texture_size_s *const size);
+
+/* Read the given texture's metadata and the pixels of the given range of its mip
+ * levels, without touching the file's other textures or the texture's other mip
+ * levels (e.g. to stream in a texture's small mip levels first and its larger
+ * ones later). Mip level 0 is the full-size image. A 'lastMipLevel' beyond the
+ * texture's mip chain is clamped to the chain's last (1 x 1) level.
+ * 
+ * The texture's numMipLevels is set to the length of its full mip chain, but
+ * only the mipLevel[] pointers within the range are set; the others are NULL.
+ * Returns the number of mip levels read; or 0 if the texture doesn't exist,
+ * the range is empty, or the read failed.*/
+uint32_t kac10_reader__read_texture(const uint32_t textureIdx,
+                                    const uint32_t firstMipLevel,
+                                    const uint32_t lastMipLevel,
+                                    struct kac_1_0_texture_s *const texture);
+uint32_t kac10_reader__read_packed_texture(const uint32_t textureIdx,
+                                           const uint32_t firstMipLevel,
+                                           const uint32_t lastMipLevel,
+                                           struct kac_1_0_packed_texture_s *const texture);
+
+/* Like the corresponding kac10_reader__read_xxx() functions, but read the data
+ * into memory provided by the caller, of 'dstByteSize' bytes, rather than
+ * allocating it. Return the number of elements read; or 0 if the segment
+ * doesn't exist or doesn't fit into the memory.
+ * 
+ * kac10_reader__read_texture_into() reads the given texture's metadata, and
+ * the packed pixels of all of its mip levels as laid out in struct
+ * kac10_texture_size_s. It returns the number of mip levels read.*/
+uint32_t kac10_reader__read_normals_into(struct kac_1_0_normal_s *const normals, const size_t dstByteSize);
+uint32_t kac10_reader__read_materials_into(struct kac_1_0_material_s *const materials, const size_t dstByteSize);
+uint32_t kac10_reader__read_triangles_into(struct kac_1_0_triangle_s *const triangles, const size_t dstByteSize);
+uint32_t kac10_reader__read_uv_coordinates_into(struct kac_1_0_uv_coordinates_s *const uvCoords, const size_t dstByteSize);
+uint32_t kac10_reader__read_vertex_coordinates_into(struct kac_1_0_vertex_coordinates_s *const vertexCoords, const size_t dstByteSize);
+uint32_t kac10_reader__read_texture_into(const uint32_t textureIdx,
+                                         struct kac_1_0_texture_metadata_s *const metadata,
+                                         kac_1_0_packed_texture_pixel_t *const pixels,
+                                         const size_t dstByteSize);
+
+/* Like kac10_reader__read_texture_into(), but converts the pixels into the given
+ * format as they're read in. The mip levels are laid out as in struct
+ * kac10_texture_size_s, but with kac10_reader__pixel_format_byte_size() bytes
+ * per pixel.*/
+uint32_t kac10_reader__read_converted_texture_into(const uint32_t textureIdx,
+                                                   const enum kac10_pixel_format_e format,
+                                                   struct kac_1_0_texture_metadata_s *const metadata,
+                                                   void *const pixels,
+                                                   const size_t dstByteSize);
+
+/* Like kac10_reader__read_normals_into(), kac10_reader__read_uv_coordinates_into()
+ * and kac10_reader__read_vertex_coordinates_into(), but convert the data into
+ * fixed-point as they're read in (see struct kac10_fixed_point_conversion_s).
+ * The memory receives an array of int32_t (for 16.16) or int16_t (for 8.8)
+ * values, with each element's components one after the other as in the
+ * corresponding struct.*/
+uint32_t kac10_reader__read_normals_fixed_into(const struct kac10_fixed_point_conversion_s *const conversion,
+                                               void *const normals,
+                                               const size_t dstByteSize);
+uint32_t kac10_reader__read_uv_coordinates_fixed_into(const struct kac10_fixed_point_conversion_s *const conversion,
+                                                      void *const uvCoords,
+                                                      const size_t dstByteSize);
+uint32_t kac10_reader__read_vertex_coordinates_fixed_into(const struct kac10_fixed_point_conversion_s *const conversion,
+                                                          void *const vertexCoords,
+                                                          const size_t dstByteSize);
+
+/* Returns the number of bytes per pixel in the given pixel format.*/
+unsigned kac10_reader__pixel_format_byte_size(const enum kac10_pixel_format_e format);
+
+/* Zero-copy equivalents of the corresponding kac10_reader__read_xxx() functions
+ * for a file opened with kac10_reader__open_file_mapped() or
+ * kac10_reader__open_memory(). Points the given pointer directly at the
+ * segment's data in memory, and returns the number of elements there. The data
+ * are valid until kac10_reader__close_file() is called, and must not be freed
+ * by the caller.
+ * 
+ * Returns 0 (and sets the pointer to NULL) if the segment doesn't exist, if
+ * the file was opened with kac10_reader__open_file(), or if the
+ * segment's data aren't suitably aligned in memory for direct access (which
+ * can happen when the segment comes after an odd-sized MATE segment). In the
+ * latter case, use the corresponding kac10_reader__read_xxx() instead.
+ */
+uint32_t kac10_reader__map_normals(const struct kac_1_0_normal_s **normals);
+uint32_t kac10_reader__map_triangles(const struct kac_1_0_triangle_s **triangles);
+uint32_t kac10_reader__map_uv_coordinates(const struct kac_1_0_uv_coordinates_s **uvCoords);
+uint32_t kac10_reader__map_vertex_coordinates(const struct kac_1_0_vertex_coordinates_s **vertexCoords);
+
+/* Accessors for the file's data, which decode a given segment only the first
+ * time it's accessed, and afterwards return the decoded data from the reader's
+ * cache. Opening a file only indexes its segments, so e.g. a tool that needs
+ * just the materials decodes just the materials. (To get the element counts
+ * without decoding anything, use kac10_reader__query_sizes().)
+ * 
+ * Point the given pointer at the data and return the number of elements; or
+ * 0 (with a NULL pointer) if the segment doesn't exist or couldn't be read. The
+ * data are owned by the reader, are valid until kac10_reader__close_file() is
+ * called, and must not be modified or freed by the caller. For a file opened
+ * with kac10_reader__open_file_mapped() or kac10_reader__open_memory(), the
+ * geometry segments are, if possible, accessed in place without any copying.*/
+uint32_t kac10_reader__get_normals(const struct kac_1_0_normal_s **normals);
+uint32_t kac10_reader__get_textures(const struct kac10_texture_set_s **textures);
+uint32_t kac10_reader__get_materials(const struct kac_1_0_material_s **materials);
+uint32_t kac10_reader__get_triangles(const struct kac_1_0_triangle_s **triangles);
+uint32_t kac10_reader__get_uv_coordinates(const struct kac_1_0_uv_coordinates_s **uvCoords);
+uint32_t kac10_reader__get_vertex_coordinates(const struct kac_1_0_vertex_coordinates_s **vertexCoords);
+
+/* Like kac10_reader__read_normals(), kac10_reader__read_uv_coordinates() and
+ * kac10_reader__read_vertex_coordinates(), but decode the data into separate
+ * arrays per component (see struct kac10_soa_vectors_s). Return the number of
+ * elements read; or 0 if the segment doesn't exist or couldn't be read, in
+ * which case the arrays are NULL. The arrays must be released with
+ * kac10_reader__free_soa_vectors().*/
+uint32_t kac10_reader__read_normals_soa(struct kac10_soa_vectors_s *const normals);
+uint32_t kac10_reader__read_uv_coordinates_soa(struct kac10_soa_vectors_s *const uvCoords);
+uint32_t kac10_reader__read_vertex_coordinates_soa(struct kac10_soa_vectors_s *const vertexCoords);
+void kac10_reader__free_soa_vectors(struct kac10_soa_vectors_s *const vectors);
+
 /* Returns 1 if the file (specified with kac10_reader__open_file()) contains
  * the given segment; otherwise, 0 is returned.*/
 int kac10_reader__file_has_normals(void);
@@ -52,4 +375,122 @@ int kac10_reader__file_has_triangles(void);
 int kac10_reader__file_has_uv_coordinates(void);
 int kac10_reader__file_has_vertex_coordinates(void);
 
+/* Reentrant versions of the above functions. The open functions return a new
+ * reader for the given file, or NULL if the file couldn't be opened or isn't
+ * a valid KAC 1.0 file. The reader is freed by kac10_reader__close_file_r().*/
+kac10_reader_t* kac10_reader__open_file_r(const char *const filename);
+kac10_reader_t* kac10_reader__open_file_mapped_r(const char *const filename);
+kac10_reader_t* kac10_reader__open_memory_r(const void *const data, const size_t byteSize);
+int kac10_reader__close_file_r(kac10_reader_t *const reader);
+int kac10_reader__input_stream_is_valid_r(const kac10_reader_t *const reader);
+
+/* Sets the allocator that the given reader uses for data returned by subsequent
+ * read calls, in place of the one set with kac10_reader__set_allocator(). The
+ * reader's own state stays with the allocator it was opened with. Passing NULL
+ * reverts to the allocator set with kac10_reader__set_allocator().*/
+void kac10_reader__set_allocator_r(kac10_reader_t *const reader, const struct kac10_allocator_s *const allocator);
+
+void kac10_reader__set_texture_layout_r(kac10_reader_t *const reader, const enum kac10_texture_layout_e layout);
+
+uint32_t kac10_reader__read_normals_r(kac10_reader_t *const reader, struct kac_1_0_normal_s **normals);
+uint32_t kac10_reader__read_textures_r(kac10_reader_t *const reader, struct kac_1_0_texture_s **textures);
+uint32_t kac10_reader__read_packed_textures_r(kac10_reader_t *const reader, struct kac_1_0_packed_texture_s **textures);
+uint32_t kac10_reader__read_texture_set_r(kac10_reader_t *const reader, struct kac10_texture_set_s *const textureSet);
+uint32_t kac10_reader__read_materials_r(kac10_reader_t *const reader, struct kac_1_0_material_s **materials);
+uint32_t kac10_reader__read_triangles_r(kac10_reader_t *const reader, struct kac_1_0_triangle_s **triangles);
+uint32_t kac10_reader__read_uv_coordinates_r(kac10_reader_t *const reader, struct kac_1_0_uv_coordinates_s **uvCoords);
+uint32_t kac10_reader__read_vertex_coordinates_r(kac10_reader_t *const reader, struct kac_1_0_vertex_coordinates_s **vertexCoords);
+
+uint32_t kac10_reader__read_texture_r(kac10_reader_t *const reader,
+                                      const uint32_t textureIdx,
+                                      const uint32_t firstMipLevel,
+                                      const uint32_t lastMipLevel,
+                                      struct kac_1_0_texture_s *const texture);
+uint32_t kac10_reader__read_packed_texture_r(kac10_reader_t *const reader,
+                                             const uint32_t textureIdx,
+                                             const uint32_t firstMipLevel,
+                                             const uint32_t lastMipLevel,
+                                             struct kac_1_0_packed_texture_s *const texture);
+
+int kac10_reader__query_sizes_r(kac10_reader_t *const reader, struct kac10_segment_sizes_s *const sizes);
+int kac10_reader__query_texture_size_r(kac10_reader_t *const reader, const uint32_t textureIdx, struct kac10_texture_size_s *const size);
+
+uint32_t kac10_reader__read_normals_into_r(kac10_reader_t *const reader, struct kac_1_0_normal_s *const normals, const size_t dstByteSize);
+uint32_t kac10_reader__read_materials_into_r(kac10_reader_t *const reader, struct kac_1_0_material_s *const materials, const size_t dstByteSize);
+uint32_t kac10_reader__read_triangles_into_r(kac10_reader_t *const reader, struct kac_1_0_triangle_s *const triangles, const size_t dstByteSize);
+uint32_t kac10_reader__read_uv_coordinates_into_r(kac10_reader_t *const reader, struct kac_1_0_uv_coordinates_s *const uvCoords, const size_t dstByteSize);
+uint32_t kac10_reader__read_vertex_coordinates_into_r(kac10_reader_t *const reader, struct kac_1_0_vertex_coordinates_s *const vertexCoords, const size_t dstByteSize);
+uint32_t kac10_reader__read_texture_into_r(kac10_reader_t *const reader,
+                                           const uint32_t textureIdx,
+                                           struct kac_1_0_texture_metadata_s *const metadata,
+                                           kac_1_0_packed_texture_pixel_t *const pixels,
+                                           const size_t dstByteSize);
+uint32_t kac10_reader__read_converted_texture_into_r(kac10_reader_t *const reader,
+                                                     const uint32_t textureIdx,
+                                                     const enum kac10_pixel_format_e format,
+                                                     struct kac_1_0_texture_metadata_s *const metadata,
+                                                     void *const pixels,
+                                                     const size_t dstByteSize);
+
+uint32_t kac10_reader__read_normals_fixed_into_r(kac10_reader_t *const reader,
+                                                  const struct kac10_fixed_point_conversion_s *const conversion,
+                                                  void *const normals,
+                                                  const size_t dstByteSize);
+uint32_t kac10_reader__read_uv_coordinates_fixed_into_r(kac10_reader_t *const reader,
+                                                         const struct kac10_fixed_point_conversion_s *const conversion,
+                                                         void *const uvCoords,
+                                                         const size_t dstByteSize);
+uint32_t kac10_reader__read_vertex_coordinates_fixed_into_r(kac10_reader_t *const reader,
+                                                             const struct kac10_fixed_point_conversion_s *const conversion,
+                                                             void *const vertexCoords,
+                                                             const size_t dstByteSize);
+
+uint32_t kac10_reader__map_normals_r(const kac10_reader_t *const reader, const struct kac_1_0_normal_s **normals);
+uint32_t kac10_reader__map_triangles_r(const kac10_reader_t *const reader, const struct kac_1_0_triangle_s **triangles);
+uint32_t kac10_reader__map_uv_coordinates_r(const kac10_reader_t *const reader, const struct kac_1_0_uv_coordinates_s **uvCoords);
+uint32_t kac10_reader__map_vertex_coordinates_r(const kac10_reader_t *const reader, const struct kac_1_0_vertex_coordinates_s **vertexCoords);
+
+uint32_t kac10_reader__get_normals_r(kac10_reader_t *const reader, const struct kac_1_0_normal_s **normals);
+uint32_t kac10_reader__get_textures_r(kac10_reader_t *const reader, const struct kac10_texture_set_s **textures);
+uint32_t kac10_reader__get_materials_r(kac10_reader_t *const reader, const struct kac_1_0_material_s **materials);
+uint32_t kac10_reader__get_triangles_r(kac10_reader_t *const reader, const struct kac_1_0_triangle_s **triangles);
+uint32_t kac10_reader__get_uv_coordinates_r(kac10_reader_t *const reader, const struct kac_1_0_uv_coordinates_s **uvCoords);
+uint32_t kac10_reader__get_vertex_coordinates_r(kac10_reader_t *const reader, const struct kac_1_0_vertex_coordinates_s **vertexCoords);
+
+uint32_t kac10_reader__read_normals_soa_r(kac10_reader_t *const reader, struct kac10_soa_vectors_s *const normals);
+uint32_t kac10_reader__read_uv_coordinates_soa_r(kac10_reader_t *const reader, struct kac10_soa_vectors_s *const uvCoords);
+uint32_t kac10_reader__read_vertex_coordinates_soa_r(kac10_reader_t *const reader, struct kac10_soa_vectors_s *const vertexCoords);
+
+/* Returns a new reader for the same file as the given reader, with its own
+ * read position, so that the file can be read from several threads at once, one
+ * reader per thread. The duplicate reads the original's data in place, and so
+ * is only available for readers opened with kac10_reader__open_file_mapped_r()
+ * or kac10_reader__open_memory_r(); for others, NULL is returned. The duplicate
+ * must be closed with kac10_reader__close_file_r() before the original is.*/
+kac10_reader_t* kac10_reader__duplicate_r(const kac10_reader_t *const reader);
+
+/* kac10_reader__read_texture_set_r() in two steps, so that the textures can be
+ * read into the set in parallel. kac10_reader__prepare_texture_set_r() allocates
+ * the set and lays it out, but doesn't read any of the textures, and returns
+ * the number of textures in the set. kac10_reader__fill_texture_set_r() then
+ * reads the metadata and pixels of the given range of textures into the set,
+ * and returns the number of textures read. Disjoint ranges can be filled at the
+ * same time using duplicates of the reader (see kac10_reader__duplicate_r()).*/
+uint32_t kac10_reader__prepare_texture_set_r(kac10_reader_t *const reader, struct kac10_texture_set_s *const textureSet);
+uint32_t kac10_reader__fill_texture_set_r(kac10_reader_t *const reader,
+                                          struct kac10_texture_set_s *const textureSet,
+                                          const uint32_t firstTextureIdx,
+                                          const uint32_t numTextures);
+
+int kac10_reader__file_has_normals_r(const kac10_reader_t *const reader);
+int kac10_reader__file_has_textures_r(const kac10_reader_t *const reader);
+int kac10_reader__file_has_materials_r(const kac10_reader_t *const reader);
+int kac10_reader__file_has_triangles_r(const kac10_reader_t *const reader);
+int kac10_reader__file_has_uv_coordinates_r(const kac10_reader_t *const reader);
+int kac10_reader__file_has_vertex_coordinates_r(const kac10_reader_t *const reader);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,462 @@
+/*
+ * 2019 Tarpeeksi Hyvae Soft
+ * 
+ * Software: Asynchronous whole-file reader for the KAC 1.0 batch reader.
+ * 
+ */
+
+#include <algorithm>
+#include <cassert>
+#include "io_uring_file_reader.hpp"
+
+#ifdef KAC10_READER_HAS_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+
+io_uring_file_reader_c::io_uring_file_reader_c(const unsigned queueDepth, const size_t maxBufferedBytes) :
+    bufferBudget(std::make_shared<buffer_budget_s>()),
+    maxBufferedBytes(maxBufferedBytes)
+{
+    io_uring_params params;
+
+    std::memset(&params, 0, sizeof(params));
+
+    this->ringFd = syscall(__NR_io_uring_setup, std::max(1u, queueDepth), &params);
+
+    if (this->ringFd < 0)
+    {
+        return;
+    }
+
+    // IORING_FEAT_RW_CUR_POS was introduced alongside IORING_OP_READ (in Linux
+    // 5.6), so its presence tells us that the read operation is supported.
+    if (!(params.features & IORING_FEAT_RW_CUR_POS))
+    {
+        close(this->ringFd);
+        this->ringFd = -1;
+
+        return;
+    }
+
+    this->queueDepth = params.sq_entries;
+    this->sqRingByteSize = (params.sq_off.array + (params.sq_entries * sizeof(unsigned)));
+    this->cqRingByteSize = (params.cq_off.cqes + (params.cq_entries * sizeof(io_uring_cqe)));
+    this->sqEntriesByteSize = (params.sq_entries * sizeof(io_uring_sqe));
+
+    // On kernels with IORING_FEAT_SINGLE_MMAP, the submission and completion rings
+    // share a single mapping.
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        this->sqRingByteSize = this->cqRingByteSize = std::max(this->sqRingByteSize, this->cqRingByteSize);
+    }
+
+    this->sqRing = mmap(nullptr, this->sqRingByteSize, (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_POPULATE), this->ringFd, IORING_OFF_SQ_RING);
+    this->cqRing = ((params.features & IORING_FEAT_SINGLE_MMAP)? this->sqRing
+                    : mmap(nullptr, this->cqRingByteSize, (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_POPULATE), this->ringFd, IORING_OFF_CQ_RING));
+    this->sqEntries = mmap(nullptr, this->sqEntriesByteSize, (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_POPULATE), this->ringFd, IORING_OFF_SQES);
+
+    if ((this->sqRing == MAP_FAILED) ||
+        (this->cqRing == MAP_FAILED) ||
+        (this->sqEntries == MAP_FAILED))
+    {
+        if (this->sqEntries != MAP_FAILED) munmap(this->sqEntries, this->sqEntriesByteSize);
+        if ((this->cqRing != MAP_FAILED) && (this->cqRing != this->sqRing)) munmap(this->cqRing, this->cqRingByteSize);
+        if (this->sqRing != MAP_FAILED) munmap(this->sqRing, this->sqRingByteSize);
+
+        close(this->ringFd);
+        this->ringFd = -1;
+
+        return;
+    }
+
+    this->sqTail = (unsigned*)((uint8_t*)this->sqRing + params.sq_off.tail);
+    this->sqMask = (unsigned*)((uint8_t*)this->sqRing + params.sq_off.ring_mask);
+    this->sqArray = (unsigned*)((uint8_t*)this->sqRing + params.sq_off.array);
+    this->cqHead = (unsigned*)((uint8_t*)this->cqRing + params.cq_off.head);
+    this->cqTail = (unsigned*)((uint8_t*)this->cqRing + params.cq_off.tail);
+    this->cqMask = (unsigned*)((uint8_t*)this->cqRing + params.cq_off.ring_mask);
+    this->cqEntries = ((uint8_t*)this->cqRing + params.cq_off.cqes);
+
+    this->ioThread = std::thread(&io_uring_file_reader_c::io_loop, this);
+
+    return;
+}
+
+io_uring_file_reader_c::~io_uring_file_reader_c(void)
+{
+    if (!this->is_available())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->requestMutex);
+        this->isStopping = true;
+    }
+
+    this->requestAvailable.notify_one();
+    this->ioThread.join();
+
+    munmap(this->sqEntries, this->sqEntriesByteSize);
+    if (this->cqRing != this->sqRing) munmap(this->cqRing, this->cqRingByteSize);
+    munmap(this->sqRing, this->sqRingByteSize);
+    close(this->ringFd);
+
+    return;
+}
+
+bool io_uring_file_reader_c::is_available(void) const
+{
+    return (this->ringFd >= 0);
+}
+
+void io_uring_file_reader_c::read_file(const std::string &filename, completion_callback_t onCompletion)
+{
+    assert(this->is_available() && "Attempting to use an unavailable io_uring reader.");
+
+    {
+        std::lock_guard<std::mutex> lock(this->requestMutex);
+        this->requests.emplace_back(filename, std::move(onCompletion));
+    }
+
+    this->requestAvailable.notify_one();
+
+    return;
+}
+
+void io_uring_file_reader_c::begin_file_read(const std::string &filename, completion_callback_t &&onCompletion)
+{
+    struct stat fileInfo;
+
+    if (this->ringFailed)
+    {
+        onCompletion(std::make_shared<std::vector<uint8_t>>(), false);
+        return;
+    }
+
+    const int fd = open(filename.c_str(), (O_RDONLY | O_CLOEXEC));
+
+    if ((fd < 0) ||
+        (fstat(fd, &fileInfo) != 0) ||
+        (fileInfo.st_size <= 0))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+
+        onCompletion(std::make_shared<std::vector<uint8_t>>(), false);
+
+        return;
+    }
+
+    this->bufferBudget->numBufferedBytes += fileInfo.st_size;
+
+    file_read_s *const file = new file_read_s;
+
+    file->fd = fd;
+    file->data.resize(fileInfo.st_size);
+    file->onCompletion = std::move(onCompletion);
+    file->numChunksRemaining = 0;
+    file->failed = false;
+
+    for (uint64_t byteOffset = 0; byteOffset < file->data.size(); byteOffset += CHUNK_BYTE_SIZE)
+    {
+        const uint32_t byteSize = std::min(uint64_t(CHUNK_BYTE_SIZE), (file->data.size() - byteOffset));
+
+        this->pendingChunks.push_back(new chunk_read_s{file, byteOffset, byteSize});
+        file->numChunksRemaining++;
+    }
+
+    return;
+}
+
+void io_uring_file_reader_c::queue_chunk_read(chunk_read_s *const chunk)
+{
+    const unsigned tail = *this->sqTail;
+    const unsigned idx = (tail & *this->sqMask);
+    io_uring_sqe *const sqe = &((io_uring_sqe*)this->sqEntries)[idx];
+
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = chunk->file->fd;
+    sqe->off = chunk->byteOffset;
+    sqe->addr = (uint64_t)(chunk->file->data.data() + chunk->byteOffset);
+    sqe->len = chunk->byteSize;
+    sqe->user_data = (uint64_t)chunk;
+
+    this->sqArray[idx] = idx;
+
+    // Publish the entry to the kernel only once it's been fully written.
+    __atomic_store_n(this->sqTail, (tail + 1), __ATOMIC_RELEASE);
+
+    this->numChunksQueued++;
+
+    return;
+}
+
+void io_uring_file_reader_c::reap_completions(void)
+{
+    unsigned head = *this->cqHead;
+    const unsigned tail = __atomic_load_n(this->cqTail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++)
+    {
+        const io_uring_cqe *const cqe = &((io_uring_cqe*)this->cqEntries)[head & *this->cqMask];
+        chunk_read_s *const chunk = (chunk_read_s*)cqe->user_data;
+        const int result = cqe->res;
+
+        this->numChunksInFlight--;
+
+        if ((result == -EAGAIN) ||
+            (result == -EINTR))
+        {
+            this->pendingChunks.push_front(chunk);
+            continue;
+        }
+
+        // On a short read, the rest of the chunk is requested again.
+        if ((result > 0) &&
+            (uint32_t(result) < chunk->byteSize))
+        {
+            chunk->byteOffset += result;
+            chunk->byteSize -= result;
+            this->pendingChunks.push_front(chunk);
+            continue;
+        }
+
+        // A read of 0 bytes means that the file was shorter than expected.
+        this->finish_chunk_read(chunk, (result > 0));
+    }
+
+    // Let the kernel reuse the completion entries.
+    __atomic_store_n(this->cqHead, head, __ATOMIC_RELEASE);
+
+    return;
+}
+
+void io_uring_file_reader_c::finish_chunk_read(chunk_read_s *const chunk, const bool succeeded)
+{
+    file_read_s *const file = chunk->file;
+
+    if (!succeeded)
+    {
+        file->failed = true;
+    }
+
+    delete chunk;
+
+    if (!--file->numChunksRemaining)
+    {
+        this->finish_file_read(file);
+    }
+
+    return;
+}
+
+void io_uring_file_reader_c::fail_pending_chunk_reads(void)
+{
+    while (!this->pendingChunks.empty())
+    {
+        chunk_read_s *const chunk = this->pendingChunks.front();
+
+        this->pendingChunks.pop_front();
+        this->finish_chunk_read(chunk, false);
+    }
+
+    return;
+}
+
+void io_uring_file_reader_c::abandon_ring(void)
+{
+    // The entries not yet submitted are the last ones before the tail, which the
+    // kernel hasn't consumed, so they can be withdrawn by moving the tail back.
+    const unsigned tail = *this->sqTail;
+    const unsigned queuedHead = (tail - this->numChunksQueued);
+
+    __atomic_store_n(this->sqTail, queuedHead, __ATOMIC_RELEASE);
+
+    for (unsigned i = queuedHead; i != tail; i++)
+    {
+        const io_uring_sqe *const sqe = &((io_uring_sqe*)this->sqEntries)[this->sqArray[i & *this->sqMask]];
+
+        this->finish_chunk_read((chunk_read_s*)sqe->user_data, false);
+    }
+
+    this->numChunksQueued = 0;
+    this->ringFailed = true;
+
+    this->fail_pending_chunk_reads();
+
+    return;
+}
+
+void io_uring_file_reader_c::finish_file_read(file_read_s *const file)
+{
+    close(file->fd);
+
+    // The data's bytes are released from the budget once the caller is done
+    // with them.
+    const std::shared_ptr<buffer_budget_s> budget = this->bufferBudget;
+    const size_t byteSize = file->data.size();
+
+    std::shared_ptr<std::vector<uint8_t>> data(new std::vector<uint8_t>(std::move(file->data)),
+                                               [budget, byteSize](std::vector<uint8_t> *const data)
+                                               {
+                                                   delete data;
+
+                                                   budget->numBufferedBytes -= byteSize;
+
+                                                   // Taking the lock makes sure the I/O thread is either
+                                                   // waiting or yet to check the budget.
+                                                   {
+                                                       std::lock_guard<std::mutex> lock(budget->mutex);
+                                                   }
+
+                                                   budget->released.notify_one();
+                                               });
+
+    file->onCompletion(std::move(data), !file->failed);
+
+    delete file;
+
+    return;
+}
+
+void io_uring_file_reader_c::io_loop(void)
+{
+    while (true)
+    {
+        const bool isIdle = (this->pendingChunks.empty() && !this->numChunksInFlight);
+
+        // If there's no I/O in progress, wait for requests; otherwise, the I/O in
+        // progress is attended to first.
+        if (isIdle)
+        {
+            std::unique_lock<std::mutex> lock(this->requestMutex);
+
+            this->requestAvailable.wait(lock, [this]{ return (!this->requests.empty() || this->isStopping); });
+
+            if (this->requests.empty())
+            {
+                break;
+            }
+        }
+
+        // With nothing in progress and the budget used up, no completions are
+        // coming in, so wait for the caller to release earlier files' data.
+        if (isIdle)
+        {
+            std::unique_lock<std::mutex> lock(this->bufferBudget->mutex);
+
+            this->bufferBudget->released.wait(lock, [this]{ return (this->bufferBudget->numBufferedBytes < this->maxBufferedBytes); });
+        }
+
+        // Pick up newly requested files for as long as the budget allows. The
+        // rest stay in the queue for now.
+        while (this->bufferBudget->numBufferedBytes < this->maxBufferedBytes)
+        {
+            std::pair<std::string, completion_callback_t> request;
+
+            {
+                std::lock_guard<std::mutex> lock(this->requestMutex);
+
+                if (this->requests.empty())
+                {
+                    break;
+                }
+
+                request = std::move(this->requests.front());
+                this->requests.pop_front();
+            }
+
+            this->begin_file_read(request.first, std::move(request.second));
+        }
+
+        // With the ring abandoned, only the reads submitted before that remain to
+        // be reaped. Those that would be resubmitted are failed instead.
+        if (this->ringFailed)
+        {
+            this->reap_completions();
+            this->fail_pending_chunk_reads();
+
+            if (this->numChunksInFlight)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            continue;
+        }
+
+        // Fill the submission ring with as many reads as there's room for, then
+        // submit them all at once and wait for at least one to complete.
+        while (!this->pendingChunks.empty() &&
+               ((this->numChunksQueued + this->numChunksInFlight) < this->queueDepth))
+        {
+            this->queue_chunk_read(this->pendingChunks.front());
+            this->pendingChunks.pop_front();
+        }
+
+        if (this->numChunksQueued || this->numChunksInFlight)
+        {
+            const int numSubmitted = syscall(__NR_io_uring_enter, this->ringFd, this->numChunksQueued, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+
+            // EINTR, EAGAIN and EBUSY are transient, and the call is simply made
+            // again. Any other error would recur on every call, with the reads
+            // never completing.
+            if ((numSubmitted < 0) &&
+                (errno != EINTR) &&
+                (errno != EAGAIN) &&
+                (errno != EBUSY))
+            {
+                this->abandon_ring();
+            }
+
+            if (numSubmitted > 0)
+            {
+                this->numChunksQueued -= numSubmitted;
+                this->numChunksInFlight += numSubmitted;
+            }
+
+            this->reap_completions();
+        }
+    }
+
+    return;
+}
+
+#else
+
+io_uring_file_reader_c::io_uring_file_reader_c(const unsigned, const size_t)
+{
+    return;
+}
+
+io_uring_file_reader_c::~io_uring_file_reader_c(void)
+{
+    return;
+}
+
+bool io_uring_file_reader_c::is_available(void) const
+{
+    return false;
+}
+
+void io_uring_file_reader_c::read_file(const std::string&, completion_callback_t onCompletion)
+{
+    assert(!"Attempting to use an unavailable io_uring reader.");
+
+    onCompletion(std::make_shared<std::vector<uint8_t>>(), false);
+
+    return;
+}
+
+#endif
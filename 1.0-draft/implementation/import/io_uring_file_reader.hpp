@@ -0,0 +1,177 @@
+/*
+ * 2019 Tarpeeksi Hyvae Soft
+ * 
+ * Software: Asynchronous whole-file reader for the KAC 1.0 batch reader.
+ * 
+ * Reads files into memory with Linux's io_uring interface, keeping many reads
+ * in flight at once, so that fast storage devices aren't left waiting on one
+ * request at a time. The reads are issued and completed on a dedicated I/O
+ * thread.
+ * 
+ * On platforms without io_uring, or where the kernel refuses to set it up, the
+ * reader is unavailable (see is_available()), and callers should fall back to
+ * synchronous reads. io_uring is taken to be unsupported on kernels older than
+ * 5.6, which lack the IORING_OP_READ operation.
+ * 
+ * The files' data are held in memory until the caller is done with them, so to
+ * bound memory use, new files aren't begun while the data of the files already
+ * read add up to more than a given number of bytes. Requested files past that
+ * wait in the queue until the caller releases some of the data.
+ * 
+ */
+
+#ifndef IO_URING_FILE_READER_H
+#define IO_URING_FILE_READER_H
+
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <thread>
+#include <deque>
+#include <mutex>
+
+#if defined(__linux__) && defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #define KAC10_READER_HAS_IO_URING
+    #endif
+#endif
+
+class io_uring_file_reader_c
+{
+    public:
+        // Called with the file's full contents once it's been read, or with
+        // 'success' set to false if the file couldn't be read. Called from the
+        // I/O thread, so should return quickly (e.g. by handing the data over to
+        // a worker thread for decoding). The data count toward the reader's
+        // memory budget until the last reference to them is dropped.
+        typedef std::function<void(std::shared_ptr<std::vector<uint8_t>> data, const bool success)> completion_callback_t;
+
+        // 'queueDepth' is the maximum number of reads in flight at once.
+        // 'maxBufferedBytes' is the memory budget: no new file is begun while the
+        // files being read and those whose data are still referenced take up at
+        // least this many bytes. A single file larger than this is still read.
+        static constexpr size_t DEFAULT_MAX_BUFFERED_BYTES = (256 * 1024 * 1024);
+
+        io_uring_file_reader_c(const unsigned queueDepth = 64,
+                               const size_t maxBufferedBytes = DEFAULT_MAX_BUFFERED_BYTES);
+
+        // Finishes the reads that have been requested, then shuts down.
+        ~io_uring_file_reader_c(void);
+
+        // Returns true if io_uring was successfully set up, i.e. if files can be
+        // read with read_file().
+        bool is_available(void) const;
+
+        // Queues the given file to be read, calling 'onCompletion' when done.
+        void read_file(const std::string &filename, completion_callback_t onCompletion);
+
+    private:
+        // A file being read, in one or more chunks.
+        struct file_read_s
+        {
+            int fd;
+            std::vector<uint8_t> data;
+            completion_callback_t onCompletion;
+            unsigned numChunksRemaining;
+            bool failed;
+        };
+
+        // A single read request for part of a file.
+        struct chunk_read_s
+        {
+            file_read_s *file;
+            uint64_t byteOffset;
+            uint32_t byteSize;
+        };
+
+        void io_loop(void);
+
+        // Opens the given file and queues up reads for its chunks. If the file
+        // can't be opened, calls the completion callback right away.
+        void begin_file_read(const std::string &filename, completion_callback_t &&onCompletion);
+
+        // Writes the given chunk read into the submission ring. It'll be submitted
+        // to the kernel on the next call to io_uring_enter().
+        void queue_chunk_read(chunk_read_s *const chunk);
+
+        // Processes the reads in the completion ring.
+        void reap_completions(void);
+
+        // Marks the given chunk read as done, and finishes its file's read if this
+        // was the file's last chunk. A failed chunk fails the file.
+        void finish_chunk_read(chunk_read_s *const chunk, const bool succeeded);
+
+        // Fails the chunk reads that are waiting for room in the submission ring.
+        void fail_pending_chunk_reads(void);
+
+        // Stops using the ring after an unrecoverable io_uring_enter() failure.
+        // The reads written into the ring but not submitted are taken back out of
+        // it and failed, as are those waiting for room in it. Reads already
+        // submitted are still reaped, since the kernel may be writing into their
+        // buffers.
+        void abandon_ring(void);
+
+        void finish_file_read(file_read_s *const file);
+
+        // The largest number of bytes read from a file with a single request.
+        static const uint32_t CHUNK_BYTE_SIZE = (1024 * 1024);
+
+        #ifdef KAC10_READER_HAS_IO_URING
+            int ringFd = -1;
+            unsigned queueDepth = 0;
+
+            // Set if the ring has been abandoned (see abandon_ring()), after which
+            // all files are failed without being read.
+            bool ringFailed = false;
+
+            // The submission and completion rings, shared with the kernel, and
+            // pointers to their fields.
+            void *sqRing = nullptr;
+            void *cqRing = nullptr;
+            void *sqEntries = nullptr;
+            size_t sqRingByteSize = 0;
+            size_t cqRingByteSize = 0;
+            size_t sqEntriesByteSize = 0;
+            unsigned *sqTail = nullptr;
+            unsigned *sqMask = nullptr;
+            unsigned *sqArray = nullptr;
+            unsigned *cqHead = nullptr;
+            unsigned *cqTail = nullptr;
+            unsigned *cqMask = nullptr;
+            void *cqEntries = nullptr;
+        #endif
+
+        // Chunk reads waiting for room in the submission ring; the number of reads
+        // written into the ring but not yet submitted; and the number submitted
+        // but not yet completed.
+        std::deque<chunk_read_s*> pendingChunks;
+        unsigned numChunksQueued = 0;
+        unsigned numChunksInFlight = 0;
+
+        // The number of bytes taken up by the files being read and those whose
+        // data the caller still holds. Shared with the data's deleters, which may
+        // run after the reader has been destroyed.
+        struct buffer_budget_s
+        {
+            std::atomic<size_t> numBufferedBytes{0};
+            std::mutex mutex;
+            std::condition_variable released;
+        };
+
+        std::shared_ptr<buffer_budget_s> bufferBudget;
+        size_t maxBufferedBytes = 0;
+
+        // Files requested with read_file() but not yet picked up by the I/O thread.
+        std::mutex requestMutex;
+        std::condition_variable requestAvailable;
+        std::deque<std::pair<std::string, completion_callback_t>> requests;
+        bool isStopping = false;
+
+        std::thread ioThread;
+};
+
+#endif
@@ -0,0 +1,353 @@
+/*
+ * 2019 Tarpeeksi Hyvae Soft
+ * 
+ * Software: Vertex buffer builder for the KAC 1.0 data format.
+ * 
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "vertex_buffer_kac_1_0.h"
+
+#define ALLOCATOR_MALLOC(allocator, size) ((allocator).mallocFn((size), (allocator).userData))
+#define ALLOCATOR_FREE(allocator, ptr)    ((allocator).freeFn((ptr), (allocator).userData))
+
+/* Byte sizes rounded up so that the arrays placed one after another in the
+ * vertex buffer's memory stay aligned for their elements.*/
+#define ALIGNED_SIZE(byteSize) (((byteSize) + 7) & ~(size_t)7)
+
+static void* default_malloc(const size_t size, void *const userData)
+{
+    (void)userData;
+
+    return malloc(size);
+}
+
+static void* default_calloc(const size_t count, const size_t size, void *const userData)
+{
+    (void)userData;
+
+    return calloc(count, size);
+}
+
+static void default_free(void *const ptr, void *const userData)
+{
+    (void)userData;
+
+    free(ptr);
+
+    return;
+}
+
+/* A vertex's combination of vertex coordinate, normal and UV indices, packed
+ * into a single value for hashing. Stored in the hash table plus 1, so that 0
+ * marks an empty slot.*/
+#define VERTEX_KEY(vertex) ((((uint64_t)(vertex).vertexCoordinatesIdx) << 32) |\
+                            (((uint64_t)(vertex).normalIdx) << 16) |\
+                            ((uint64_t)(vertex).uvIdx))
+
+/* Scratch memory for the build: the triangles in material order, the vertex
+ * index of each triangle corner, the key of each unique vertex, and an open-
+ * addressing hash table (with linear probing) mapping keys to vertex indices.*/
+struct build_scratch_s
+{
+    uint32_t *triangleOrder;
+    uint32_t *cornerVertexIdx;
+    uint64_t *vertexKeys;
+    uint64_t *tableKeys;
+    uint32_t *tableValues;
+    unsigned tableSizeLog2;
+};
+
+/* Orders the triangles by material with a counting sort, keeping triangles of
+ * the same material in their original order. Returns the number of distinct
+ * materials used; or 0 on failure.*/
+static uint32_t sort_triangles_by_material(const struct kac_1_0_triangle_s *const triangles,
+                                           const uint32_t numTriangles,
+                                           uint32_t *const triangleOrder,
+                                           const struct kac10_allocator_s *const allocator)
+{
+    uint32_t i = 0, numMaterials = 0;
+    uint32_t *const materialOffsets = ALLOCATOR_MALLOC(*allocator, ((UINT16_MAX + 2) * sizeof(uint32_t)));
+
+    if (!materialOffsets)
+    {
+        return 0;
+    }
+
+    memset(materialOffsets, 0, ((UINT16_MAX + 2) * sizeof(uint32_t)));
+
+    for (i = 0; i < numTriangles; i++)
+    {
+        if (!materialOffsets[triangles[i].materialIdx + 1]++)
+        {
+            numMaterials++;
+        }
+    }
+
+    for (i = 1; i < (UINT16_MAX + 2); i++)
+    {
+        materialOffsets[i] += materialOffsets[i - 1];
+    }
+
+    for (i = 0; i < numTriangles; i++)
+    {
+        triangleOrder[materialOffsets[triangles[i].materialIdx]++] = i;
+    }
+
+    ALLOCATOR_FREE(*allocator, materialOffsets);
+
+    return numMaterials;
+}
+
+/* Returns the index of the unique vertex with the given key, adding the vertex
+ * if it's not yet in the hash table.*/
+static uint32_t find_or_add_vertex(struct build_scratch_s *const scratch,
+                                   const uint64_t key,
+                                   uint32_t *const numVertices)
+{
+    const uint64_t tableMask = (((uint64_t)1 << scratch->tableSizeLog2) - 1);
+    uint64_t slot = ((key * UINT64_C(0x9e3779b97f4a7c15)) >> (64 - scratch->tableSizeLog2));
+
+    while (scratch->tableKeys[slot])
+    {
+        if (scratch->tableKeys[slot] == (key + 1))
+        {
+            return scratch->tableValues[slot];
+        }
+
+        slot = ((slot + 1) & tableMask);
+    }
+
+    scratch->tableKeys[slot] = (key + 1);
+    scratch->tableValues[slot] = *numVertices;
+    scratch->vertexKeys[*numVertices] = key;
+
+    return (*numVertices)++;
+}
+
+int kac10_vertex_buffer__build(struct kac10_vertex_buffer_s *const vertexBuffer,
+                               const struct kac_1_0_triangle_s *const triangles,
+                               const uint32_t numTriangles,
+                               const struct kac_1_0_vertex_coordinates_s *const vertexCoords,
+                               const uint32_t numVertexCoords,
+                               const struct kac_1_0_normal_s *const normals,
+                               const uint32_t numNormals,
+                               const struct kac_1_0_uv_coordinates_s *const uvCoords,
+                               const uint32_t numUVCoords,
+                               const unsigned indexByteSize,
+                               const struct kac10_allocator_s *const allocator)
+{
+    static const struct kac10_allocator_s defaultAllocator = {default_malloc, default_calloc, default_free, NULL};
+    const size_t numCorners = ((size_t)numTriangles * 3);
+    struct build_scratch_s scratch;
+    uint32_t i = 0, c = 0, numVertices = 0, numMaterials = 0;
+    size_t tableSize = 0;
+    uint8_t *memory = NULL;
+    int success = 1;
+
+    memset(vertexBuffer, 0, sizeof(*vertexBuffer));
+    memset(&scratch, 0, sizeof(scratch));
+
+    vertexBuffer->allocator = (allocator? *allocator : defaultAllocator);
+
+    if (!numTriangles ||
+        ((indexByteSize != 0) && (indexByteSize != 2) && (indexByteSize != 4)))
+    {
+        return 0;
+    }
+
+    /* Make sure that the triangles only reference existing elements.*/
+    for (i = 0; i < numTriangles; i++)
+    {
+        for (c = 0; c < 3; c++)
+        {
+            const struct kac_1_0_vertex_s *const vertex = &triangles[i].vertices[c];
+
+            if ((vertex->vertexCoordinatesIdx >= numVertexCoords) ||
+                (numNormals && (vertex->normalIdx >= numNormals)) ||
+                (numUVCoords && (vertex->uvIdx >= numUVCoords)))
+            {
+                return 0;
+            }
+        }
+    }
+
+    /* The hash table has room for at least twice the number of triangle corners,
+     * the most unique vertices there can be.*/
+    for (scratch.tableSizeLog2 = 4; (((size_t)1 << scratch.tableSizeLog2) < (numCorners * 2)); scratch.tableSizeLog2++);
+    tableSize = ((size_t)1 << scratch.tableSizeLog2);
+
+    scratch.triangleOrder = ALLOCATOR_MALLOC(vertexBuffer->allocator, (numTriangles * sizeof(*scratch.triangleOrder)));
+    scratch.cornerVertexIdx = ALLOCATOR_MALLOC(vertexBuffer->allocator, (numCorners * sizeof(*scratch.cornerVertexIdx)));
+    scratch.vertexKeys = ALLOCATOR_MALLOC(vertexBuffer->allocator, (numCorners * sizeof(*scratch.vertexKeys)));
+    scratch.tableKeys = ALLOCATOR_MALLOC(vertexBuffer->allocator, (tableSize * sizeof(*scratch.tableKeys)));
+    scratch.tableValues = ALLOCATOR_MALLOC(vertexBuffer->allocator, (tableSize * sizeof(*scratch.tableValues)));
+
+    if (!scratch.triangleOrder ||
+        !scratch.cornerVertexIdx ||
+        !scratch.vertexKeys ||
+        !scratch.tableKeys ||
+        !scratch.tableValues ||
+        !(numMaterials = sort_triangles_by_material(triangles, numTriangles, scratch.triangleOrder, &vertexBuffer->allocator)))
+    {
+        success = 0;
+    }
+
+    /* Find the unique vertices, and which of them each triangle corner uses.*/
+    if (success)
+    {
+        memset(scratch.tableKeys, 0, (tableSize * sizeof(*scratch.tableKeys)));
+
+        for (i = 0; i < numTriangles; i++)
+        {
+            const struct kac_1_0_triangle_s *const triangle = &triangles[scratch.triangleOrder[i]];
+
+            for (c = 0; c < 3; c++)
+            {
+                scratch.cornerVertexIdx[(i * 3) + c] = find_or_add_vertex(&scratch, VERTEX_KEY(triangle->vertices[c]), &numVertices);
+            }
+        }
+
+        vertexBuffer->indexByteSize = (indexByteSize? indexByteSize : ((numVertices <= (UINT16_MAX + 1))? 2 : 4));
+
+        if ((vertexBuffer->indexByteSize == 2) &&
+            (numVertices > (UINT16_MAX + 1)))
+        {
+            success = 0;
+        }
+    }
+
+    /* Lay out the vertices, indices and draw ranges in a single allocation.*/
+    if (success)
+    {
+        const size_t verticesByteSize = ALIGNED_SIZE(numVertices * sizeof(struct kac10_interleaved_vertex_s));
+        const size_t indicesByteSize = ALIGNED_SIZE(numCorners * vertexBuffer->indexByteSize);
+        const size_t drawRangesByteSize = ALIGNED_SIZE(numMaterials * sizeof(struct kac10_draw_range_s));
+
+        if (!(memory = ALLOCATOR_MALLOC(vertexBuffer->allocator, (verticesByteSize + indicesByteSize + drawRangesByteSize))))
+        {
+            success = 0;
+        }
+        else
+        {
+            vertexBuffer->memory = memory;
+            vertexBuffer->vertices = (struct kac10_interleaved_vertex_s*)memory;
+            vertexBuffer->indices = (memory + verticesByteSize);
+            vertexBuffer->drawRanges = (struct kac10_draw_range_s*)(memory + verticesByteSize + indicesByteSize);
+        }
+    }
+
+    if (success)
+    {
+        vertexBuffer->numVertices = numVertices;
+        vertexBuffer->numIndices = numCorners;
+
+        for (i = 0; i < numVertices; i++)
+        {
+            struct kac10_interleaved_vertex_s *const vertex = &vertexBuffer->vertices[i];
+            const uint32_t vertexCoordinatesIdx = (uint32_t)(scratch.vertexKeys[i] >> 32);
+            const uint32_t normalIdx = (uint32_t)((scratch.vertexKeys[i] >> 16) & 0xffff);
+            const uint32_t uvIdx = (uint32_t)(scratch.vertexKeys[i] & 0xffff);
+
+            memset(vertex, 0, sizeof(*vertex));
+
+            vertex->x = vertexCoords[vertexCoordinatesIdx].x;
+            vertex->y = vertexCoords[vertexCoordinatesIdx].y;
+            vertex->z = vertexCoords[vertexCoordinatesIdx].z;
+
+            if (numNormals)
+            {
+                vertex->nx = normals[normalIdx].x;
+                vertex->ny = normals[normalIdx].y;
+                vertex->nz = normals[normalIdx].z;
+            }
+
+            if (numUVCoords)
+            {
+                vertex->u = uvCoords[uvIdx].u;
+                vertex->v = uvCoords[uvIdx].v;
+            }
+        }
+
+        if (vertexBuffer->indexByteSize == 2)
+        {
+            uint16_t *const indices = vertexBuffer->indices;
+
+            for (i = 0; i < numCorners; i++)
+            {
+                indices[i] = (uint16_t)scratch.cornerVertexIdx[i];
+            }
+        }
+        else
+        {
+            memcpy(vertexBuffer->indices, scratch.cornerVertexIdx, (numCorners * sizeof(uint32_t)));
+        }
+
+        /* The triangles are in material order, so each material's triangles form
+         * a single run of indices.*/
+        for (i = 0; i < numTriangles; i++)
+        {
+            const uint16_t materialIdx = triangles[scratch.triangleOrder[i]].materialIdx;
+
+            if (!vertexBuffer->numDrawRanges ||
+                (vertexBuffer->drawRanges[vertexBuffer->numDrawRanges - 1].materialIdx != materialIdx))
+            {
+                vertexBuffer->drawRanges[vertexBuffer->numDrawRanges].materialIdx = materialIdx;
+                vertexBuffer->drawRanges[vertexBuffer->numDrawRanges].firstIndex = (i * 3);
+                vertexBuffer->drawRanges[vertexBuffer->numDrawRanges].numIndices = 0;
+                vertexBuffer->numDrawRanges++;
+            }
+
+            vertexBuffer->drawRanges[vertexBuffer->numDrawRanges - 1].numIndices += 3;
+        }
+    }
+
+    if (scratch.triangleOrder) ALLOCATOR_FREE(vertexBuffer->allocator, scratch.triangleOrder);
+    if (scratch.cornerVertexIdx) ALLOCATOR_FREE(vertexBuffer->allocator, scratch.cornerVertexIdx);
+    if (scratch.vertexKeys) ALLOCATOR_FREE(vertexBuffer->allocator, scratch.vertexKeys);
+    if (scratch.tableKeys) ALLOCATOR_FREE(vertexBuffer->allocator, scratch.tableKeys);
+    if (scratch.tableValues) ALLOCATOR_FREE(vertexBuffer->allocator, scratch.tableValues);
+
+    if (!success)
+    {
+        kac10_vertex_buffer__free(vertexBuffer);
+    }
+
+    return success;
+}
+
+int kac10_vertex_buffer__build_from_reader_r(struct kac10_vertex_buffer_s *const vertexBuffer,
+                                             kac10_reader_t *const reader,
+                                             const unsigned indexByteSize,
+                                             const struct kac10_allocator_s *const allocator)
+{
+    const struct kac_1_0_triangle_s *triangles = NULL;
+    const struct kac_1_0_vertex_coordinates_s *vertexCoords = NULL;
+    const struct kac_1_0_normal_s *normals = NULL;
+    const struct kac_1_0_uv_coordinates_s *uvCoords = NULL;
+    const uint32_t numTriangles = kac10_reader__get_triangles_r(reader, &triangles);
+    const uint32_t numVertexCoords = kac10_reader__get_vertex_coordinates_r(reader, &vertexCoords);
+    const uint32_t numNormals = kac10_reader__get_normals_r(reader, &normals);
+    const uint32_t numUVCoords = kac10_reader__get_uv_coordinates_r(reader, &uvCoords);
+
+    return kac10_vertex_buffer__build(vertexBuffer,
+                                      triangles, numTriangles,
+                                      vertexCoords, numVertexCoords,
+                                      normals, numNormals,
+                                      uvCoords, numUVCoords,
+                                      indexByteSize,
+                                      allocator);
+}
+
+void kac10_vertex_buffer__free(struct kac10_vertex_buffer_s *const vertexBuffer)
+{
+    if (vertexBuffer->memory)
+    {
+        ALLOCATOR_FREE(vertexBuffer->allocator, vertexBuffer->memory);
+    }
+
+    memset(vertexBuffer, 0, sizeof(*vertexBuffer));
+
+    return;
+}
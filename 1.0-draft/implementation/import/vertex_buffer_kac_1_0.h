@@ -0,0 +1,97 @@
+/*
+ * 2019 Tarpeeksi Hyvae Soft
+ * 
+ * Software: Vertex buffer builder for the KAC 1.0 data format.
+ * 
+ * KAC 1.0 triangles index vertex coordinates, normals and UV coordinates
+ * separately. Renderers generally want instead a single index per vertex into
+ * an array of complete vertices. This builds such an array, with one vertex
+ * per unique combination of vertex coordinates, normal and UV coordinates, and
+ * a 16- or 32-bit index buffer into it.
+ * 
+ */
+
+#ifndef VERTEX_BUFFER_KAC_1_0_H
+#define VERTEX_BUFFER_KAC_1_0_H
+
+#include "import_kac_1_0.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A complete vertex, as referenced by the index buffer.*/
+struct kac10_interleaved_vertex_s
+{
+    float x, y, z;
+    float nx, ny, nz;
+    float u, v;
+};
+
+/* A run of consecutive triangles in the index buffer that share a material, so
+ * that they can be drawn with a single draw call.*/
+struct kac10_draw_range_s
+{
+    uint16_t materialIdx;
+    uint32_t firstIndex;
+    uint32_t numIndices;
+};
+
+struct kac10_vertex_buffer_s
+{
+    struct kac10_interleaved_vertex_s *vertices;
+    uint32_t numVertices;
+
+    /* Three indices per triangle, each 'indexByteSize' (2 or 4) bytes, i.e. to be
+     * accessed as uint16_t or uint32_t. The triangles are ordered by material.*/
+    void *indices;
+    uint32_t numIndices;
+    unsigned indexByteSize;
+
+    struct kac10_draw_range_s *drawRanges;
+    uint32_t numDrawRanges;
+
+    /* The single allocation holding the above arrays, and the allocator that
+     * allocated it.*/
+    void *memory;
+    struct kac10_allocator_s allocator;
+};
+
+/* Builds a vertex buffer out of the given KAC 1.0 triangles and the vertex
+ * coordinates, normals and UV coordinates they index. If there are no normals
+ * or no UV coordinates (their count is 0), those vertex attributes are set to
+ * 0. 'indexByteSize' is 2 or 4 for 16- or 32-bit indices, or 0 to use 16-bit
+ * indices if the vertices can be indexed with them, and 32-bit otherwise.
+ * 'allocator' can be NULL to use malloc() and free().
+ * 
+ * Returns 1 on success. Returns 0 if a triangle references a nonexistent
+ * element, if the vertices can't be indexed with 16-bit indices when so asked,
+ * or if memory couldn't be allocated. The buffer must be released with
+ * kac10_vertex_buffer__free() (which is safe to call also on a buffer that
+ * failed to build).*/
+int kac10_vertex_buffer__build(struct kac10_vertex_buffer_s *const vertexBuffer,
+                               const struct kac_1_0_triangle_s *const triangles,
+                               const uint32_t numTriangles,
+                               const struct kac_1_0_vertex_coordinates_s *const vertexCoords,
+                               const uint32_t numVertexCoords,
+                               const struct kac_1_0_normal_s *const normals,
+                               const uint32_t numNormals,
+                               const struct kac_1_0_uv_coordinates_s *const uvCoords,
+                               const uint32_t numUVCoords,
+                               const unsigned indexByteSize,
+                               const struct kac10_allocator_s *const allocator);
+
+/* Like kac10_vertex_buffer__build(), but takes the data from the given reader,
+ * using the kac10_reader__get_xxx_r() functions.*/
+int kac10_vertex_buffer__build_from_reader_r(struct kac10_vertex_buffer_s *const vertexBuffer,
+                                             kac10_reader_t *const reader,
+                                             const unsigned indexByteSize,
+                                             const struct kac10_allocator_s *const allocator);
+
+void kac10_vertex_buffer__free(struct kac10_vertex_buffer_s *const vertexBuffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,210 @@
+/*
+ * 2019 Tarpeeksi Hyvae Soft
+ * 
+ * Software: Work-stealing thread pool for the KAC 1.0 batch reader.
+ * 
+ */
+
+#include <algorithm>
+#include <cassert>
+#include "work_stealing_pool.hpp"
+
+// The pool, if any, that the current thread is a worker of, and the index of
+// the worker's task queue.
+static thread_local const work_stealing_pool_c *CURRENT_POOL = nullptr;
+static thread_local unsigned CURRENT_QUEUE_IDX = 0;
+
+// The id of the task the current worker is running, if any.
+static thread_local uint64_t CURRENT_TASK_ID = 0;
+
+work_stealing_pool_c::work_stealing_pool_c(const unsigned numThreads)
+{
+    const unsigned threadCount = (numThreads? numThreads : std::max(1u, std::thread::hardware_concurrency()));
+
+    for (unsigned i = 0; i < threadCount; i++)
+    {
+        this->queues.push_back(std::make_unique<task_queue_s>());
+    }
+
+    for (unsigned i = 0; i < threadCount; i++)
+    {
+        this->threads.emplace_back(&work_stealing_pool_c::worker_loop, this, i);
+    }
+
+    return;
+}
+
+work_stealing_pool_c::~work_stealing_pool_c(void)
+{
+    // The workers finish any tasks still in the queues before exiting.
+    {
+        std::lock_guard<std::mutex> lock(this->sleepMutex);
+        this->isStopping = true;
+    }
+
+    this->wakeup.notify_all();
+
+    for (auto &thread: this->threads)
+    {
+        thread.join();
+    }
+
+    return;
+}
+
+unsigned work_stealing_pool_c::num_threads(void) const
+{
+    return this->threads.size();
+}
+
+bool work_stealing_pool_c::is_pool_thread(void) const
+{
+    return (CURRENT_POOL == this);
+}
+
+unsigned work_stealing_pool_c::current_thread_queue_idx(void) const
+{
+    assert(this->is_pool_thread() && "Expected to be called from a worker thread.");
+
+    return CURRENT_QUEUE_IDX;
+}
+
+void work_stealing_pool_c::submit(std::function<void(void)> task)
+{
+    const unsigned queueIdx = (this->is_pool_thread()? this->current_thread_queue_idx()
+                                                     : (this->nextQueueIdx++ % this->queues.size()));
+
+    {
+        std::lock_guard<std::mutex> lock(this->queues[queueIdx]->mutex);
+        this->queues[queueIdx]->tasks.push_back({std::move(task),
+                                                 this->nextTaskId++,
+                                                 (this->is_pool_thread()? CURRENT_TASK_ID : 0)});
+    }
+
+    // The count is incremented under the sleep mutex so that a worker about to
+    // go to sleep can't miss the wakeup.
+    {
+        std::lock_guard<std::mutex> lock(this->sleepMutex);
+        this->numQueuedTasks++;
+    }
+
+    this->wakeup.notify_one();
+
+    return;
+}
+
+bool work_stealing_pool_c::run_pending_task(const unsigned queueIdx)
+{
+    queued_task_s task = {};
+
+    // The worker's own queue is used as a stack, so that the most recently
+    // queued (and so likely cache-warm) task runs first.
+    {
+        std::lock_guard<std::mutex> lock(this->queues[queueIdx]->mutex);
+
+        if (!this->queues[queueIdx]->tasks.empty())
+        {
+            task = std::move(this->queues[queueIdx]->tasks.back());
+            this->queues[queueIdx]->tasks.pop_back();
+        }
+    }
+
+    // Other workers' queues are stolen from at the front, i.e. the oldest task.
+    for (unsigned i = 1; (!task.function && (i < this->queues.size())); i++)
+    {
+        task_queue_s &victim = *this->queues[(queueIdx + i) % this->queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+
+    if (!task.function)
+    {
+        return false;
+    }
+
+    this->run_task(task);
+
+    return true;
+}
+
+bool work_stealing_pool_c::run_pending_subtask(const unsigned queueIdx)
+{
+    queued_task_s task = {};
+
+    if (!CURRENT_TASK_ID)
+    {
+        return false;
+    }
+
+    // Tasks submitted from outside the pool may have been queued after the
+    // subtasks, so the queue is searched rather than just popped.
+    {
+        std::lock_guard<std::mutex> lock(this->queues[queueIdx]->mutex);
+        auto &tasks = this->queues[queueIdx]->tasks;
+
+        for (auto it = tasks.rbegin(); it != tasks.rend(); ++it)
+        {
+            if (it->parentId == CURRENT_TASK_ID)
+            {
+                task = std::move(*it);
+                tasks.erase(std::next(it).base());
+                break;
+            }
+        }
+    }
+
+    if (!task.function)
+    {
+        return false;
+    }
+
+    this->run_task(task);
+
+    return true;
+}
+
+void work_stealing_pool_c::run_task(queued_task_s &task)
+{
+    const uint64_t parentTaskId = CURRENT_TASK_ID;
+
+    this->numQueuedTasks--;
+
+    CURRENT_TASK_ID = task.id;
+    task.function();
+    CURRENT_TASK_ID = parentTaskId;
+
+    return;
+}
+
+void work_stealing_pool_c::worker_loop(const unsigned queueIdx)
+{
+    CURRENT_POOL = this;
+    CURRENT_QUEUE_IDX = queueIdx;
+
+    while (true)
+    {
+        if (this->run_pending_task(queueIdx))
+        {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(this->sleepMutex);
+
+        this->wakeup.wait(lock, [this]{ return (this->numQueuedTasks || this->isStopping); });
+
+        if (this->isStopping &&
+            !this->numQueuedTasks)
+        {
+            break;
+        }
+    }
+
+    CURRENT_POOL = nullptr;
+
+    return;
+}
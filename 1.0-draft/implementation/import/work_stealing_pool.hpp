@@ -0,0 +1,122 @@
+/*
+ * 2019 Tarpeeksi Hyvae Soft
+ * 
+ * Software: Work-stealing thread pool for the KAC 1.0 batch reader.
+ * 
+ * Each worker thread has its own task queue. Tasks submitted from a worker go
+ * into that worker's queue, and those submitted from elsewhere are spread over
+ * the queues in turn. A worker runs tasks from the back of its own queue and,
+ * when that runs dry, steals from the front of the others'.
+ * 
+ * A task waiting on its subtasks runs them in the meantime, but only them, so
+ * that unrelated tasks (e.g. another file's decode) don't get nested inside it.
+ * 
+ */
+
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+class work_stealing_pool_c
+{
+    public:
+        // If 'numThreads' is 0, one thread is created per hardware thread.
+        work_stealing_pool_c(const unsigned numThreads = 0);
+        ~work_stealing_pool_c(void);
+
+        // Queues the given task to be run on one of the pool's threads.
+        void submit(std::function<void(void)> task);
+
+        // Queues the given callable to be run on one of the pool's threads, and
+        // returns a future for its return value.
+        template <typename F>
+        auto async(F &&function) -> std::future<decltype(function())>
+        {
+            auto task = std::make_shared<std::packaged_task<decltype(function())(void)>>(std::forward<F>(function));
+            auto future = task->get_future();
+
+            this->submit([task]{ (*task)(); });
+
+            return future;
+        }
+
+        // Waits for the given future to become ready. If called from one of the
+        // pool's threads, runs in the meantime those of the calling task's
+        // subtasks that are still queued, rather than blocking, so that tasks can
+        // wait on tasks they've submitted without deadlocking the pool.
+        template <typename T>
+        void wait(const std::future<T> &future)
+        {
+            while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                if (!this->is_pool_thread() ||
+                    !this->run_pending_subtask(this->current_thread_queue_idx()))
+                {
+                    future.wait_for(std::chrono::microseconds(100));
+                }
+            }
+
+            return;
+        }
+
+        unsigned num_threads(void) const;
+
+        // Returns true if the calling thread is one of this pool's worker threads.
+        bool is_pool_thread(void) const;
+
+    private:
+        struct queued_task_s
+        {
+            std::function<void(void)> function;
+            uint64_t id;
+
+            // The id of the task that submitted this one, or 0 if it was
+            // submitted from outside the pool.
+            uint64_t parentId;
+        };
+
+        struct task_queue_s
+        {
+            std::mutex mutex;
+            std::deque<queued_task_s> tasks;
+        };
+
+        void worker_loop(const unsigned queueIdx);
+
+        // Runs one task: from the back of the given queue if it has any, otherwise
+        // from the front of another queue. Returns false if there were no tasks.
+        bool run_pending_task(const unsigned queueIdx);
+
+        // Runs the most recently queued subtask of the task running on the
+        // calling worker, if any are still in the worker's queue (which is where
+        // its subtasks are submitted to). Returns false if there were none.
+        bool run_pending_subtask(const unsigned queueIdx);
+
+        void run_task(queued_task_s &task);
+
+        unsigned current_thread_queue_idx(void) const;
+
+        std::vector<std::unique_ptr<task_queue_s>> queues;
+        std::vector<std::thread> threads;
+
+        // Idle workers sleep on this until tasks are queued or the pool shuts down.
+        std::mutex sleepMutex;
+        std::condition_variable wakeup;
+        std::atomic<unsigned> numQueuedTasks{0};
+        std::atomic<unsigned> nextQueueIdx{0};
+        std::atomic<uint64_t> nextTaskId{1};
+        bool isStopping = false;
+};
+
+#endif
@@ -29,16 +29,18 @@
 #define KAC_1_0_MAX_TEXTURE_SIDE_LENGTH 256u
 #define KAC_1_0_MIN_TEXTURE_SIDE_LENGTH 1u
 
+struct kac_1_0_texture_metadata_s
+{
+    unsigned sideLength : 16;
+    unsigned sampleLinearly : 1;
+    unsigned clampUV : 1;
+    unsigned padding : 14;
+    uint8_t pixelHash[16]; /* 128 bits of a hash of the texture's pixel data.*/
+};
+
 struct kac_1_0_texture_s
 {
-    struct kac_1_0_texture_metadata_s
-    {
-        unsigned sideLength : 16;
-        unsigned sampleLinearly : 1;
-        unsigned clampUV : 1;
-        unsigned padding : 14;
-        uint8_t pixelHash[16]; /* 128 bits of a hash of the texture's pixel data.*/
-    } metadata;
+    struct kac_1_0_texture_metadata_s metadata;
 
     struct kac_1_0_texture_pixel_s
     {
@@ -51,6 +53,32 @@ struct kac_1_0_texture_s
     unsigned numMipLevels;
 };
 
+/* A texture pixel in the 16-bit 5551 format that KAC 1.0 stores pixels in: red
+ * in bits 0-4, green in bits 5-9, blue in bits 10-14, and alpha in bit 15.
+ * 
+ * Unlike struct kac_1_0_texture_pixel_s, whose size depends on how the compiler
+ * lays out bitfields (typically 4 bytes), this matches the on-disk format, so
+ * pixel data can be copied or mapped directly from a KAC file.*/
+typedef uint16_t kac_1_0_packed_texture_pixel_t;
+
+#define KAC_1_0_PACKED_PIXEL_R(pixel) (((pixel) >> 0)  & 0x1f)
+#define KAC_1_0_PACKED_PIXEL_G(pixel) (((pixel) >> 5)  & 0x1f)
+#define KAC_1_0_PACKED_PIXEL_B(pixel) (((pixel) >> 10) & 0x1f)
+#define KAC_1_0_PACKED_PIXEL_A(pixel) (((pixel) >> 15) & 0x1)
+
+#define KAC_1_0_PACK_PIXEL(r, g, b, a) ((kac_1_0_packed_texture_pixel_t)((((r) & 0x1f) << 0)  |\
+                                                                          (((g) & 0x1f) << 5)  |\
+                                                                          (((b) & 0x1f) << 10) |\
+                                                                          (((a) & 0x1)  << 15)))
+
+/* A texture whose pixels are in the packed 16-bit format.*/
+struct kac_1_0_packed_texture_s
+{
+    struct kac_1_0_texture_metadata_s metadata;
+    kac_1_0_packed_texture_pixel_t *mipLevel[KAC_1_0_MAX_NUM_MIP_LEVELS];
+    unsigned numMipLevels;
+};
+
 struct kac_1_0_material_s
 {
     struct kac_1_0_material_color_s